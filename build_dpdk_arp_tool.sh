@@ -18,6 +18,13 @@ if [ ! -f "dpdk_arp_discover.c" ]; then
     exit 1
 fi
 
+# The engine's multi-process layout (secondary mode)
+if [ ! -f "src/netgen_mp.h" ]; then
+    echo "✗ src/netgen_mp.h not found!"
+    echo "  Please place the engine sources (src/) in /opt/netgen-dpdk"
+    exit 1
+fi
+
 # Check for DPDK development files
 echo "▶ Checking DPDK development files..."
 if ! pkg-config --exists libdpdk; then
@@ -31,11 +38,11 @@ echo ""
 # Compile
 echo "▶ Compiling DPDK ARP discovery tool..."
 
-gcc -O3 -march=native \
+gcc -O3 -march=native -Isrc \
     dpdk_arp_discover.c \
     -o dpdk_arp_discover \
     $(pkg-config --cflags --libs libdpdk) \
-    -lrte_eal -lrte_ethdev -lrte_mbuf -lrte_mempool
+    -lrte_eal -lrte_ethdev -lrte_mbuf -lrte_mempool -lrte_ring
 
 if [ $? -eq 0 ] && [ -f "dpdk_arp_discover" ]; then
     echo "  ✓ Compilation successful"
@@ -69,6 +76,9 @@ echo ""
 echo "Example:"
 echo "  sudo ./dpdk_arp_discover 0 192.168.1.1 192.168.1.100"
 echo ""
+echo "While dpdk_engine runs, the tool attaches to it as a DPDK secondary"
+echo "process and probes through the engine's rings; traffic keeps running."
+echo ""
 echo "Next steps:"
 echo "  1. Update ports API to use this tool"
 echo "  2. Restart web server"
@@ -2,20 +2,34 @@
  * DPDK ARP Discovery Tool
  * Sends ARP requests on DPDK-bound interfaces to discover connected devices
  * 
- * Compile: gcc -O3 dpdk_arp_discover.c -o dpdk_arp_discover $(pkg-config --cflags --libs libdpdk)
- * Usage: sudo ./dpdk_arp_discover <port_id> <target_ip>
+ * While dpdk_engine runs, the tool attaches to it as a DPDK secondary
+ * process and probes through the engine's inject and capture rings
+ * (src/netgen_mp.h) instead of taking the port over. Without a running
+ * engine it configures the port itself, as before.
+ *
+ * Compile: gcc -O3 -Isrc dpdk_arp_discover.c -o dpdk_arp_discover $(pkg-config --cflags --libs libdpdk)
+ * Usage: sudo ./dpdk_arp_discover <port_id> <target_ip> [source_ip]
+ *        sudo ./dpdk_arp_discover -l 0 --proc-type=secondary -- <port_id> <target_ip> [source_ip]
+ *
+ * The first form runs on lcore NETGEN_LCORE (default 0, the engine's usual
+ * main lcore) with --file-prefix NETGEN_FILE_PREFIX (default "rte", DPDK's
+ * own default); set them when the engine was started otherwise.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <rte_eal.h>
 #include <rte_ethdev.h>
 #include <rte_mbuf.h>
 #include <rte_ether.h>
 #include <rte_arp.h>
+#include <rte_ring.h>
+#include <rte_memzone.h>
+#include "netgen_mp.h"
 
 #define NUM_MBUFS 8191
 #define MBUF_CACHE_SIZE 250
@@ -31,6 +45,71 @@ struct arp_packet {
 
 static struct rte_mempool *mbuf_pool = NULL;
 
+// Secondary mode: the engine sends and captures for us
+static struct netgen_mp_port *engine_port = NULL;
+static struct rte_ring *inject_ring = NULL;
+static struct rte_ring *capture_ring = NULL;
+static int consumer_slot = -1;
+
+// Find the engine's rings and pool for port_id
+static int attach_engine(uint16_t port_id) {
+    const struct rte_memzone *mz = rte_memzone_lookup(NETGEN_MP_INFO_NAME);
+    if (!mz) {
+        fprintf(stderr, "No engine memzone %s\n", NETGEN_MP_INFO_NAME);
+        return -1;
+    }
+    
+    struct netgen_mp_info *info = mz->addr;
+    if (info->magic != NETGEN_MP_MAGIC || info->version != NETGEN_MP_VERSION) {
+        fprintf(stderr, "Engine memzone version mismatch\n");
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < info->num_ports; i++) {
+        if (info->ports[i].port_id == port_id) {
+            engine_port = &info->ports[i];
+        }
+    }
+    if (!engine_port) {
+        fprintf(stderr, "Port %u is not used by the engine\n", port_id);
+        return -1;
+    }
+    
+    mbuf_pool = rte_mempool_lookup(engine_port->pool_name);
+    inject_ring = rte_ring_lookup(engine_port->inject_ring);
+    capture_ring = rte_ring_lookup(engine_port->capture_ring);
+    if (!mbuf_pool || !inject_ring || !capture_ring) {
+        fprintf(stderr, "Cannot find the engine's pool or rings for port %u\n", port_id);
+        return -1;
+    }
+    
+    // Claim a consumer slot; the engine releases it if we die without detaching
+    int32_t pid = getpid();
+    for (int c = 0; c < NETGEN_MP_MAX_CONSUMERS; c++) {
+        int32_t expected = 0;
+        if (__atomic_compare_exchange_n(&engine_port->consumer_pids[c], &expected, pid, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            consumer_slot = c;
+            __atomic_fetch_add(&engine_port->capture_consumers, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+    }
+    fprintf(stderr, "Too many capture consumers on port %u\n", port_id);
+    engine_port = NULL;
+    return -1;
+}
+
+static void detach_engine(void) {
+    if (engine_port) {
+        int32_t pid = getpid();
+        if (__atomic_compare_exchange_n(&engine_port->consumer_pids[consumer_slot], &pid, 0, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            __atomic_fetch_sub(&engine_port->capture_consumers, 1, __ATOMIC_RELAXED);
+        }
+        engine_port = NULL;
+    }
+}
+
 // Send ARP request
 static int send_arp_request(uint16_t port_id, uint32_t src_ip, uint32_t dst_ip) {
     struct rte_mbuf *pkt;
@@ -74,8 +153,13 @@ static int send_arp_request(uint16_t port_id, uint32_t src_ip, uint32_t dst_ip)
     pkt->data_len = sizeof(struct arp_packet);
     pkt->pkt_len = sizeof(struct arp_packet);
     
-    // Send packet
-    uint16_t nb_tx = rte_eth_tx_burst(port_id, 0, &pkt, 1);
+    // Send packet (the engine owns the mbuf once it is on the ring)
+    uint16_t nb_tx;
+    if (inject_ring) {
+        nb_tx = rte_ring_mp_enqueue(inject_ring, pkt) == 0;
+    } else {
+        nb_tx = rte_eth_tx_burst(port_id, 0, &pkt, 1);
+    }
     
     if (nb_tx == 0) {
         rte_pktmbuf_free(pkt);
@@ -92,7 +176,12 @@ static int receive_arp_replies(uint16_t port_id, uint32_t target_ip, int timeout
     int iterations = timeout_ms / 10;  // 10ms per iteration
     
     for (int i = 0; i < iterations && !found; i++) {
-        uint16_t nb_rx = rte_eth_rx_burst(port_id, 0, pkts, BURST_SIZE);
+        uint16_t nb_rx;
+        if (capture_ring) {
+            nb_rx = rte_ring_mc_dequeue_burst(capture_ring, (void **)pkts, BURST_SIZE, NULL);
+        } else {
+            nb_rx = rte_eth_rx_burst(port_id, 0, pkts, BURST_SIZE);
+        }
         
         for (uint16_t j = 0; j < nb_rx; j++) {
             struct arp_packet *arp_pkt = rte_pktmbuf_mtod(pkts[j], struct arp_packet *);
@@ -129,45 +218,21 @@ static int receive_arp_replies(uint16_t port_id, uint32_t target_ip, int timeout
     return found ? 0 : -1;
 }
 
-int main(int argc, char **argv) {
-    int ret;
-    uint16_t port_id;
-    uint32_t src_ip, dst_ip;
-    
-    if (argc < 3) {
-        fprintf(stderr, "Usage: %s <port_id> <target_ip> [source_ip]\n", argv[0]);
-        fprintf(stderr, "Example: %s 0 192.168.1.1 192.168.1.100\n", argv[0]);
-        return 1;
-    }
-    
-    port_id = atoi(argv[1]);
-    
-    // Parse target IP
-    struct in_addr addr;
-    if (inet_pton(AF_INET, argv[2], &addr) != 1) {
-        fprintf(stderr, "Invalid target IP\n");
-        return 1;
-    }
-    dst_ip = ntohl(addr.s_addr);
-    
-    // Parse or generate source IP
-    if (argc >= 4) {
-        if (inet_pton(AF_INET, argv[3], &addr) != 1) {
-            fprintf(stderr, "Invalid source IP\n");
-            return 1;
+// Probe up to 3 times; 0 when the target answered
+static int probe(uint16_t port_id, uint32_t src_ip, uint32_t dst_ip) {
+    for (int i = 0; i < 3; i++) {
+        send_arp_request(port_id, src_ip, dst_ip);
+        
+        if (receive_arp_replies(port_id, dst_ip, 1000) == 0) {
+            return 0;
         }
-        src_ip = ntohl(addr.s_addr);
-    } else {
-        // Use same subnet as target, but .100
-        src_ip = (dst_ip & 0xFFFFFF00) | 100;
-    }
-    
-    // Initialize DPDK
-    ret = rte_eal_init(argc, argv);
-    if (ret < 0) {
-        fprintf(stderr, "DPDK EAL init failed\n");
-        return 1;
     }
+    return -1;
+}
+
+// Own the port: configure one RX and one TX queue and start it
+static int init_port(uint16_t port_id) {
+    int ret;
     
     // Create mbuf pool
     mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", NUM_MBUFS,
@@ -175,7 +240,7 @@ int main(int argc, char **argv) {
     
     if (!mbuf_pool) {
         fprintf(stderr, "Cannot create mbuf pool\n");
-        return 1;
+        return -1;
     }
     
     // Configure port
@@ -183,7 +248,7 @@ int main(int argc, char **argv) {
     ret = rte_eth_dev_configure(port_id, 1, 1, &port_conf);
     if (ret < 0) {
         fprintf(stderr, "Cannot configure port %u\n", port_id);
-        return 1;
+        return -1;
     }
     
     // Setup RX queue
@@ -191,7 +256,7 @@ int main(int argc, char **argv) {
         rte_eth_dev_socket_id(port_id), NULL, mbuf_pool);
     if (ret < 0) {
         fprintf(stderr, "Cannot setup RX queue\n");
-        return 1;
+        return -1;
     }
     
     // Setup TX queue
@@ -199,34 +264,104 @@ int main(int argc, char **argv) {
         rte_eth_dev_socket_id(port_id), NULL);
     if (ret < 0) {
         fprintf(stderr, "Cannot setup TX queue\n");
-        return 1;
+        return -1;
     }
     
     // Start port
     ret = rte_eth_dev_start(port_id);
     if (ret < 0) {
         fprintf(stderr, "Cannot start port %u\n", port_id);
-        return 1;
+        return -1;
     }
     
     // Set promiscuous mode
     rte_eth_promiscuous_enable(port_id);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int ret;
+    uint16_t port_id;
+    uint32_t src_ip, dst_ip;
     
-    // Send ARP request
-    printf("Sending ARP request for %s on port %u...\n", argv[2], port_id);
+    // Initialize DPDK. Without EAL options (the old "<port_id> <target_ip>"
+    // form) the tool attaches to a running engine if there is one. It must
+    // share the engine's file prefix and keep off its worker lcores.
+    const char *lcore = getenv("NETGEN_LCORE");
+    const char *prefix = getenv("NETGEN_FILE_PREFIX");
+    char prefix_arg[128];
+    snprintf(prefix_arg, sizeof(prefix_arg), "--file-prefix=%s", prefix && *prefix ? prefix : "rte");
+    char *auto_args[] = {argv[0], "--proc-type=auto", "-l", (char *)(lcore && *lcore ? lcore : "0"),
+                         prefix_arg, "--log-level=lib.*:error", NULL};
+    if (argc >= 2 && argv[1][0] != '-') {
+        ret = rte_eal_init(RTE_DIM(auto_args) - 1, auto_args);
+        if (ret >= 0) ret = 0;
+    } else {
+        ret = rte_eal_init(argc, argv);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "DPDK EAL init failed\n");
+        return 1;
+    }
+    argc -= ret;
+    argv += ret;
+    if (argc >= 2 && strcmp(argv[1], "--") == 0) {
+        argv[1] = argv[0];
+        argc--;
+        argv++;
+    }
     
-    for (int i = 0; i < 3; i++) {  // Try 3 times
-        send_arp_request(port_id, src_ip, dst_ip);
-        
-        if (receive_arp_replies(port_id, dst_ip, 1000) == 0) {
-            // Success
-            rte_eth_dev_stop(port_id);
-            return 0;
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s [EAL options --] <port_id> <target_ip> [source_ip]\n", argv[0]);
+        fprintf(stderr, "Example: %s 0 192.168.1.1 192.168.1.100\n", argv[0]);
+        return 1;
+    }
+    
+    port_id = atoi(argv[1]);
+    
+    // Parse target IP
+    struct in_addr addr;
+    if (inet_pton(AF_INET, argv[2], &addr) != 1) {
+        fprintf(stderr, "Invalid target IP\n");
+        return 1;
+    }
+    dst_ip = ntohl(addr.s_addr);
+    
+    // Parse or generate source IP
+    if (argc >= 4) {
+        if (inet_pton(AF_INET, argv[3], &addr) != 1) {
+            fprintf(stderr, "Invalid source IP\n");
+            return 1;
+        }
+        src_ip = ntohl(addr.s_addr);
+    } else {
+        // Use same subnet as target, but .100
+        src_ip = (dst_ip & 0xFFFFFF00) | 100;
+    }
+    
+    int secondary = rte_eal_process_type() == RTE_PROC_SECONDARY;
+    if (secondary) {
+        if (attach_engine(port_id) != 0) {
+            return 1;
         }
+    } else if (init_port(port_id) != 0) {
+        return 1;
     }
     
-    printf("NOT_FOUND\n");
+    // Send ARP request
+    printf("Sending ARP request for %s on port %u%s...\n", argv[2], port_id,
+           secondary ? " (through dpdk_engine)" : "");
+    
+    ret = probe(port_id, src_ip, dst_ip);
+    if (ret != 0) {
+        printf("NOT_FOUND\n");
+    }
     
-    rte_eth_dev_stop(port_id);
-    return 1;
+    if (secondary) {
+        detach_engine();
+    } else {
+        rte_eth_dev_stop(port_id);
+    }
+    rte_eal_cleanup();
+    return ret == 0 ? 0 : 1;
 }
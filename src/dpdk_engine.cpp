@@ -13,12 +13,24 @@
 #include <rte_tcp.h>
 #include <rte_udp.h>
 #include <rte_icmp.h>
+#include <rte_arp.h>
 #include <rte_cycles.h>
 #include <rte_lcore.h>
 #include <rte_ring.h>
 #include <rte_hash.h>
+#include <rte_malloc.h>
+#include <rte_mbuf_dyn.h>
+#include <rte_hash_crc.h>
+#include <rte_telemetry.h>
+#include <rte_memzone.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <signal.h>
@@ -29,14 +41,74 @@
 #include <string>
 #include <cmath>
 #include <random>
+#include <algorithm>
 
-#define RX_RING_SIZE 2048
-#define TX_RING_SIZE 2048
-#define NUM_MBUFS 8191
-#define MBUF_CACHE_SIZE 250
+#define ARP_RX_RING_SIZE 256           // Control-frame RX queue of tx_port
+#define ARP_RING_SIZE 1024
 #define BURST_SIZE 64
 #define MAX_PROFILES 64
+#define TX_MAX_CATCHUP 16             // Frames a late profile may send at once
 #define PAYLOAD_OFFSET 42
+#define MAX_STREAMS (MAX_PROFILES + 1)
+
+// Sequence window: 2^19 packets = ~5 ms of history at 100 Mpps
+#define SEQ_WINDOW_BITS (1u << 19)
+#define SEQ_WINDOW_MASK (SEQ_WINDOW_BITS - 1)
+#define SEQ_WINDOW_WORDS (SEQ_WINDOW_BITS / 64)
+
+// Log-linear latency histogram: 16 sub-buckets per power of two (<6.25% error)
+#define LAT_HIST_SUB_BITS 4
+#define LAT_HIST_SUB (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_BUCKETS (LAT_HIST_SUB * 48)
+
+// Microburst detection
+#define MICROBURST_RING_SIZE 4096       // Buckets of history per RX queue (power of 2)
+#define MICROBURST_LOG_SIZE 256         // Bounded event log
+#define MICROBURST_SCAN_US 1000         // Detector merges closed buckets this often
+#define ETHER_WIRE_OVERHEAD 24          // Preamble + SFD + IFG + CRC
+
+// Flow sketches (bounded memory per RX queue)
+#define HLL_PRECISION 14                // 2^14 registers, ~0.8% standard error
+#define HLL_REGISTERS (1u << HLL_PRECISION)
+#define CMS_DEPTH 4
+#define CMS_WIDTH (1u << 16)            // Overestimate <= e/CMS_WIDTH * packets
+#define TOPK_SIZE 32
+#define TOPK_STRIDE 64                  // Re-check top-K every 64 counts of a flow
+
+#include "dpdk_engine_v4.h"
+#include "netgen_stats_shm.h"
+#include "netgen_mp.h"
+#include "dpdk_link_discovery.h"
+
+// RFC 2544 orchestration
+#define RFC2544_DRAIN_MS 2000           // RFC 2544 26.1: wait 2 s for residual frames
+#define RFC2544_MAX_WATCHERS 8
+#define ETHER_PREAMBLE_IFG 20           // Preamble + SFD + IFG (frame sizes include CRC)
+#define RFC2544_PROBE_STREAM (MAX_STREAMS - 1)
+#define RFC2544_PROBE_PPS 1000          // Tagged latency probes per second
+#define RFC2544_LOSS_STEPS 10           // Frame loss sweep: 100%, 90%, ... 10%
+#define RFC2544_B2B_MAX_SEC 2           // Longest back-to-back burst tried
+#define RFC2544_OFFERED_TOL 0.001       // Sent may trail the scheduled load by 0.1%
+#define Y1564_MAX_SERVICES 16
+#define Y1564_MAX_STEPS 6               // 25/50/75/100% CIR, CIR+EIR, policing
+#define Y1564_AVAIL_WINDOW 10           // Y.1563: 10 consecutive SES change availability
+#define RFC2889_MAX_ADDRESSES (1u << 20)
+#define RFC2889_LEARN_STREAM (MAX_STREAMS - 2)
+#define RFC2889_TEST_STREAM (MAX_STREAMS - 1)
+#define RFC2889_MAC_BASE 0x020000000000ULL  // Locally administered unicast
+#define RFC2889_TEST_SRC_MAC 0x02FF00000001ULL
+#define RFC2889_SETTLE_MS 100
+
+// Test signature embedded at PAYLOAD_OFFSET of every generated UDP frame.
+// 16 bytes so it still fits the 18-byte UDP payload of a 64-byte frame.
+#define NETGEN_SIG_MAGIC 0x4E47  // "NG"
+
+struct netgen_signature {
+    uint16_t magic;
+    uint16_t stream_id;
+    uint32_t seq;
+    uint64_t tx_tsc;
+} __attribute__((packed));
 
 // Protocol types
 enum protocol_type {
@@ -45,6 +117,13 @@ enum protocol_type {
     PROTO_ICMP = 2
 };
 
+// MAC address iteration (RFC 2889 address table tests)
+enum mac_iterate_mode {
+    MAC_ITER_NONE = 0,
+    MAC_ITER_SRC = 1,
+    MAC_ITER_DST = 2
+};
+
 // Payload types
 enum payload_type {
     PAYLOAD_RANDOM = 0,
@@ -81,23 +160,55 @@ struct traffic_profile {
     uint8_t custom_payload[1400];
     uint16_t custom_payload_len;
     
-    // Statistics
-    uint64_t packets_sent;
-    uint64_t bytes_sent;
-    uint64_t packets_dropped;
+    // Per-profile TX state (counters live in tx_lcore_state)
     uint32_t sequence_num;
     uint16_t stream_id;
+    
+    uint64_t packets_to_send;           // Exact-count mode (0 = continuous)
+    
+    // Ethernet addresses as 48-bit integers; with mac_iterate set, the
+    // chosen address steps through mac_count consecutive values
+    uint64_t src_mac;
+    uint64_t dst_mac;
+    uint8_t mac_iterate;
+    uint32_t mac_count;
+    uint32_t mac_index;
+    
+    // IPv4 addressing (host order). Frames cycle through src_ip_count
+    // source addresses; the ARP responder answers for all of them. With
+    // resolve_mac set, dst_mac is the resolved MAC of gateway_ip (or of
+    // dst_ip when no gateway is set).
+    uint32_t src_ip;
+    uint32_t src_ip_count;
+    uint32_t gateway_ip;
+    bool resolve_mac;
 };
 
 // Global state
-static struct rte_mempool *mbuf_pool = NULL;
+static struct rte_mempool *socket_pools[RTE_MAX_NUMA_NODES];   // One per socket with a port in use
 static traffic_profile profiles[MAX_PROFILES];
 static int num_profiles = 0;
 static volatile bool force_quit = false;
 static volatile bool running = false;
+static volatile bool tx_active = false;     // TX stops first so RX can drain
 static int tx_port = 0;
 static int rx_port = 1;
 static bool dual_port_mode = false;
+static unsigned rx_queues_requested = 0;    // --rx-queues (0 = auto)
+static unsigned flow_table_entries = 0;     // --flow-table (per RX queue, 0 = off)
+static bool flow_sketches_enabled = false;  // --sketches
+static unsigned stats_publish_hz = 100;     // --stats-hz (0 = no shared-memory stats)
+static unsigned timeseries_us_requested = 10000;  // --timeseries-us (0 = no time series)
+static uint64_t traffic_start_tsc = 0;
+static bool arp_enabled = true;             // --no-arp: no resolver/responder, no RX queue on tx_port
+static struct rte_ring *arp_ring = NULL;    // ARP/LLDP/CDP frames from the RX lcores to the resolver
+static uint16_t arp_tx_queue = 0;           // Resolver's TX queue on tx_port
+static unsigned lldp_interval_sec = 30;     // --lldp-interval (0 = do not send LLDP)
+static bool numa_strict = false;            // --numa-strict: refuse lcores on a remote socket
+static unsigned rxd_requested = 0;          // --rxd (0 = RX_RING_SIZE within the driver's limits)
+static unsigned txd_requested = 0;          // --txd (0 = TX_RING_SIZE within the driver's limits)
+static unsigned mbufs_requested = 0;        // --mbufs per pool (0 = sized from the topology)
+static unsigned mbuf_cache_size = MBUF_CACHE_SIZE;  // --mbuf-cache
 
 // RX statistics
 struct rx_stats {
@@ -114,24 +225,274 @@ struct rx_stats {
     uint64_t lost_packets;
 };
 
-static rx_stats rx_statistics;
+// NIC RX timestamping (RTE_ETH_RX_OFFLOAD_TIMESTAMP + mbuf dynfield)
+static bool rx_hw_timestamp = false;
+static int hwts_dynfield_offset = -1;
+static uint64_t hwts_dynflag = 0;
+static uint64_t tsc_ns_fp = 0;              // ns per TSC cycle, 32.32 fixed point
+
+// TSC <-> NIC clock correlation (rte_eth_read_clock on rx_port).
+// TX timestamps are TSC; they are mapped into the RX NIC clock domain so
+// latency = NIC RX timestamp - mapped TX time, free of RX PCIe/poll delay.
+#define NIC_CLOCK_RESYNC_MS 100
+
+struct nic_clock_sync {
+    uint64_t tsc_base;          // First anchor (long baseline for rate estimate)
+    uint64_t nic_base;
+    uint64_t tsc_ref;           // Latest anchor
+    uint64_t nic_ref;
+    uint64_t nic_per_tsc_fp;    // NIC ticks per TSC cycle, 32.32 fixed point
+    uint64_t ns_per_nic_fp;     // ns per NIC tick, 32.32 fixed point
+    bool valid;
+};
+
+static nic_clock_sync nic_clock_nominal;    // Calibrated once at startup
+
+// Microburst detector. Every RX queue bins arrival bytes into fixed
+// microsecond buckets in its own ring; the queue 0 lcore merges closed
+// buckets across queues, compares them with a fraction of line rate and
+// records bursts in a bounded event log.
+struct microburst_bucket {
+    uint64_t id;                // Bucket number since epoch_tsc
+    uint64_t bytes;             // Wire bytes (incl. ETHER_WIRE_OVERHEAD)
+};
+
+struct microburst_event {
+    uint64_t start_ns;          // Since traffic start
+    uint64_t duration_ns;
+    uint64_t peak_bytes;        // Largest bucket in the burst
+    uint32_t peak_pct;          // Largest bucket as % of line rate
+};
+
+struct microburst_config {
+    uint32_t bucket_us;
+    uint32_t threshold_pct;     // Bucket rate >= this % of line rate is a burst
+};
+
+struct microburst_state {
+    uint64_t epoch_tsc;
+    uint64_t bucket_cycles;
+    uint64_t line_bytes;        // Line-rate bytes per bucket
+    uint64_t threshold_bytes;
+    uint64_t next_bucket;       // Next closed bucket to merge
+    uint64_t burst_start;
+    uint64_t burst_peak;
+    bool in_burst;
+    
+    uint64_t count;
+    uint64_t max_duration_ns;
+    uint64_t log_head;          // Total events ever logged
+    microburst_event log[MICROBURST_LOG_SIZE];
+};
+
+static microburst_config microburst_cfg = {10, 90};
+static microburst_state microburst;
+
+// Per-flow RX accounting: 5-tuple + VLAN keyed rte_hash per RX queue. The
+// hash position indexes a flat entry array, so the control thread can walk
+// the counters without touching the hash itself. RSS keeps every flow on a
+// single queue, so the per-queue tables are disjoint.
+struct flow_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t vlan_id;
+    uint8_t proto;
+    uint8_t pad;
+} __attribute__((packed));
+
+struct flow_entry {
+    flow_key key;
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+// HyperLogLog (distinct flows) + Count-Min (packets per flow) + top-K
+// candidates. All three merge across queues: register max, counter sum and
+// candidate union re-estimated against the merged Count-Min.
+struct topk_entry {
+    flow_key key;
+    uint64_t estimate;
+};
+
+struct flow_sketch {
+    uint8_t hll[HLL_REGISTERS];
+    uint64_t cms[CMS_DEPTH][CMS_WIDTH];
+    topk_entry topk[TOPK_SIZE];
+    uint64_t topk_min;          // Smallest estimate in topk (admission threshold)
+    uint64_t packets;
+};
+
+// Per-stream RX state, one instance per stream per RX lcore.
+// Sequence tracking in the first cache line, latency in the second, delay
+// variation in the third; the bitmap and histogram live in a separate
+// per-lcore block.
+struct rx_stream_state {
+    uint64_t *window;           // SEQ_WINDOW_BITS ring bitmap, indexed by seq
+    uint32_t max_seq;           // Highest sequence number seen
+    uint32_t seen;              // Non-zero once the first packet arrived
+    uint64_t in_order;          // Advanced the stream's max (gaps included)
+    uint64_t out_of_order;      // Behind the stream's max on any queue
+    uint64_t duplicates;        // Already marked in the window
+    uint64_t late_arrivals;     // Older than the window, unclassifiable
+    uint64_t bytes;
+    
+    uint64_t latency_min_ns __rte_cache_aligned;
+    uint64_t latency_max_ns;
+    uint64_t latency_sum_ns;
+    uint64_t latency_count;
+    uint64_t hw_timestamps;     // Samples measured with the NIC clock
+    uint64_t *latency_hist;     // LAT_HIST_BUCKETS counters
+    
+    // RFC 3550 interarrival jitter and RFC 5481 IPDV (successive in-order
+    // arrivals on this RX queue); integer only
+    uint64_t last_latency_ns __rte_cache_aligned;
+    uint64_t jitter_q4;         // J * 16, as in RFC 3550 A.8
+    int64_t ipdv_min_ns;
+    int64_t ipdv_max_ns;
+    uint64_t ipdv_abs_sum_ns;
+    uint64_t ipdv_count;
+} __rte_cache_aligned;
+
+// Where a worker lcore spends its cycles (ENABLE_CYCLE_STATS). Every loop
+// iteration is a poll: busy if it moved frames, idle otherwise. TX bursts
+// are further split by stage. Owner-written like the other lcore counters.
+// The stall counters (tx_queue_full, alloc_failures) cost no TSC reads and
+// are always kept and reported, with or without ENABLE_CYCLE_STATS.
+enum tx_stage {
+    TX_STAGE_ALLOC = 0,
+    TX_STAGE_BUILD,
+    TX_STAGE_BURST,
+    TX_STAGE_FREE,
+    TX_STAGE_MAX
+};
+
+static const char *tx_stage_names[TX_STAGE_MAX] = {"alloc", "build", "tx_burst", "free"};
+
+struct lcore_cycle_stats {
+    uint64_t busy_cycles;
+    uint64_t idle_cycles;
+    uint64_t busy_polls;
+    uint64_t idle_polls;
+    uint64_t stage_cycles[TX_STAGE_MAX];    // TX lcores only
+    uint64_t tx_queue_full;     // tx_burst calls that left frames behind
+    uint64_t alloc_failures;    // Mempool bulk allocations that failed
+};
+
+#ifdef ENABLE_CYCLE_STATS
+static inline uint64_t cycle_now(void) {
+    return rte_rdtsc();
+}
+
+static inline void cycle_poll(lcore_cycle_stats *cs, bool busy, uint64_t start, uint64_t end) {
+    if (busy) {
+        cs->busy_cycles += end - start;
+        cs->busy_polls++;
+    } else {
+        cs->idle_cycles += end - start;
+        cs->idle_polls++;
+    }
+}
+
+// Charge the cycles since *t to a stage and restart the clock
+static inline void cycle_stage(lcore_cycle_stats *cs, int stage, uint64_t *t) {
+    uint64_t now = rte_rdtsc();
+    cs->stage_cycles[stage] += now - *t;
+    *t = now;
+}
+#else
+static inline uint64_t cycle_now(void) { return 0; }
+static inline void cycle_poll(lcore_cycle_stats*, bool, uint64_t, uint64_t) {}
+static inline void cycle_stage(lcore_cycle_stats*, int, uint64_t*) {}
+#endif
+
+// RX analysis state owned by a single RX lcore (one per RSS queue)
+struct rx_lcore_state {
+    rx_stream_state streams[MAX_STREAMS];
+    nic_clock_sync clock;
+    microburst_bucket *mb_ring;     // MICROBURST_RING_SIZE buckets
+    microburst_bucket *mb_slot;     // Bucket currently being filled
+    uint64_t mb_bucket_end;         // TSC at which mb_slot closes
+    struct rte_hash *flow_hash;     // NULL when flow accounting is off
+    flow_entry *flows;              // Indexed by rte_hash key position
+    uint64_t flow_table_full;       // Packets of flows that did not fit
+    flow_sketch *sketch;            // NULL when sketches are off
+    uint64_t packets_received;
+    uint64_t bytes_received;
+    uint64_t unsigned_packets;  // Frames without a NetGen signature
+    lcore_cycle_stats cycles;
+};
+
+// TX counters of one profile
+struct tx_counters {
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_dropped;
+    uint64_t packets_skipped;   // Schedule debt beyond TX_MAX_CATCHUP, never offered
+};
+
+// TX counters owned by a single TX lcore. Only the owner writes them; the
+// control path sums them over lcores, so no cache line is written by two
+// cores and no counter update needs to be atomic.
+struct tx_lcore_state {
+    tx_counters profiles[MAX_PROFILES];
+    tx_counters total;
+    lcore_cycle_stats cycles;
+} __rte_cache_aligned;
+
+// Lcore roles (assigned once at startup, dispatched by lcore_main)
+enum lcore_role {
+    LCORE_ROLE_IDLE = 0,
+    LCORE_ROLE_TX = 1,
+    LCORE_ROLE_RX = 2
+};
+
+struct lcore_conf {
+    uint8_t role;
+    uint16_t tx_index;          // Profiles with (index % num_tx_lcores) == tx_index
+    uint16_t queue_id;          // TX queue on tx_port or RSS queue on rx_port
+    struct rte_mempool *pool;   // Pool local to the port served
+    rx_lcore_state *rx;
+    tx_lcore_state *tx;
+} __rte_cache_aligned;
+
+static lcore_conf lcore_confs[RTE_MAX_LCORE];
+static unsigned num_tx_lcores = 0;
+static unsigned num_rx_lcores = 0;
+static rx_lcore_state *rx_queue_states[RTE_MAX_LCORE];    // By RX queue, num_rx_lcores used
 static std::map<uint32_t, uint64_t> tx_timestamp_map;
 static pthread_mutex_t timestamp_map_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Packet building
-struct rte_mbuf* build_packet(traffic_profile *prof) {
-    struct rte_mbuf *pkt = rte_pktmbuf_alloc(mbuf_pool);
-    if (!pkt) return NULL;
-    
+// Store a 48-bit integer MAC in network order
+static inline void mac_from_u64(uint64_t mac, struct rte_ether_addr *addr) {
+    uint64_t be = rte_cpu_to_be_64(mac << 16);
+    memcpy(addr->addr_bytes, &be, RTE_ETHER_ADDR_LEN);
+}
+
+// Read a MAC in network order as a 48-bit integer
+static inline uint64_t mac_to_u64(const uint8_t *bytes) {
+    uint64_t be = 0;
+    memcpy(&be, bytes, RTE_ETHER_ADDR_LEN);
+    return rte_be_to_cpu_64(be) >> 16;
+}
+
+// Packet building (into an mbuf the caller allocated)
+void build_packet(traffic_profile *prof, struct rte_mbuf *pkt) {
     uint8_t *pkt_data = rte_pktmbuf_mtod(pkt, uint8_t*);
     uint16_t offset = 0;
     
     // Ethernet header
     struct rte_ether_hdr *eth = (struct rte_ether_hdr*)pkt_data;
-    static const struct rte_ether_addr default_src_mac = {{0x00,0x11,0x22,0x33,0x44,0x55}};
-    static const struct rte_ether_addr default_dst_mac = {{0x00,0xAA,0xBB,0xCC,0xDD,0xEE}};
-    rte_ether_addr_copy(&default_src_mac, &eth->src_addr);
-    rte_ether_addr_copy(&default_dst_mac, &eth->dst_addr);
+    uint64_t src_mac = prof->src_mac;
+    uint64_t dst_mac = prof->dst_mac;
+    if (prof->mac_iterate != MAC_ITER_NONE) {
+        uint64_t *mac = prof->mac_iterate == MAC_ITER_SRC ? &src_mac : &dst_mac;
+        *mac += prof->mac_index;
+        if (++prof->mac_index == prof->mac_count) prof->mac_index = 0;
+    }
+    mac_from_u64(src_mac, &eth->src_addr);
+    mac_from_u64(dst_mac, &eth->dst_addr);
     eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
     offset = sizeof(struct rte_ether_hdr);
     
@@ -145,7 +506,9 @@ struct rte_mbuf* build_packet(traffic_profile *prof) {
     ip->time_to_live = 64;
     ip->next_proto_id = prof->protocol == PROTO_UDP ? IPPROTO_UDP :
                        prof->protocol == PROTO_TCP ? IPPROTO_TCP : IPPROTO_ICMP;
-    ip->src_addr = rte_cpu_to_be_32(0xC0A80101);  // 192.168.1.1
+    uint32_t src_ip = prof->src_ip;
+    if (prof->src_ip_count > 1) src_ip += prof->sequence_num % prof->src_ip_count;
+    ip->src_addr = rte_cpu_to_be_32(src_ip);
     ip->dst_addr = rte_cpu_to_be_32(prof->dst_ip);
     ip->hdr_checksum = 0;
     ip->hdr_checksum = rte_ipv4_cksum(ip);
@@ -163,10 +526,20 @@ struct rte_mbuf* build_packet(traffic_profile *prof) {
         udp->dgram_cksum = 0;
         offset += sizeof(struct rte_udp_hdr);
         
-        // Payload
+        // Test signature (stream, sequence, TX timestamp) for RX analysis
         uint8_t *payload = pkt_data + offset;
         uint16_t payload_data_len = payload_len - sizeof(struct rte_udp_hdr);
         
+        if (payload_data_len >= sizeof(struct netgen_signature)) {
+            struct netgen_signature *sig = (struct netgen_signature*)payload;
+            sig->magic = NETGEN_SIG_MAGIC;
+            sig->stream_id = prof->stream_id;
+            sig->seq = prof->sequence_num;
+            sig->tx_tsc = rte_rdtsc();
+            payload += sizeof(struct netgen_signature);
+            payload_data_len -= sizeof(struct netgen_signature);
+        }
+        
         switch (prof->payload_type) {
             case PAYLOAD_RANDOM:
                 for (int i = 0; i < payload_data_len; i++) payload[i] = rand() % 256;
@@ -212,43 +585,103 @@ struct rte_mbuf* build_packet(traffic_profile *prof) {
     pkt->pkt_len = prof->packet_size;
     
     prof->sequence_num++;
-    return pkt;
 }
 
 // TX thread (FIXED: uses pre-calculated cycles)
+// Each profile is owned by exactly one TX lcore so its sequence numbers stay
+// contiguous and its counters have a single writer.
 int tx_thread_main(__rte_unused void *arg) {
-    printf("TX thread started on lcore %u\n", rte_lcore_id());
+    unsigned lcore_id = rte_lcore_id();
+    unsigned tx_index = lcore_confs[lcore_id].tx_index;
+    uint16_t queue_id = lcore_confs[lcore_id].queue_id;
+    tx_lcore_state *tx = lcore_confs[lcore_id].tx;
+    struct rte_mempool *pool = lcore_confs[lcore_id].pool;
+    printf("TX thread started on lcore %u (queue %u)\n", lcore_id, queue_id);
     
-    uint64_t next_send_time[MAX_PROFILES] = {0};
+    uint64_t next_send_time[MAX_PROFILES];
+    struct rte_mbuf *pkts[TX_MAX_CATCHUP];
     
-    while (running && !force_quit) {
+    uint64_t start = rte_get_tsc_cycles();
+    for (int i = 0; i < MAX_PROFILES; i++) next_send_time[i] = start;
+    
+    lcore_cycle_stats *cs = &tx->cycles;
+    uint64_t poll_start = start;
+    bool busy = false;
+    
+    while (running && tx_active && !force_quit) {
         uint64_t now = rte_get_tsc_cycles();
+        cycle_poll(cs, busy, poll_start, now);
+        poll_start = now;
+        busy = false;
         
-        for (int i = 0; i < num_profiles; i++) {
+        for (int i = tx_index; i < num_profiles; i += num_tx_lcores) {
             if (now < next_send_time[i]) continue;
             
             traffic_profile *prof = &profiles[i];
+            tx_counters *cnt = &tx->profiles[i];
+            uint64_t gap = prof->inter_packet_gap_cycles;
             
-            // Build packet
-            struct rte_mbuf *pkt = build_packet(prof);
-            if (!pkt) {
-                prof->packets_dropped++;
-                continue;
+            // Send every frame that is due in one burst, so a profile keeps
+            // its rate while the loop is busy with many other profiles
+            uint32_t due = gap ? RTE_MIN((now - next_send_time[i]) / gap + 1, (uint64_t)TX_MAX_CATCHUP)
+                               : TX_MAX_CATCHUP;
+            if (prof->packets_to_send) {
+                if (cnt->packets_sent >= prof->packets_to_send) continue;
+                due = RTE_MIN((uint64_t)due, prof->packets_to_send - cnt->packets_sent);
             }
             
-            // Send packet
-            uint16_t nb_tx = rte_eth_tx_burst(tx_port, 0, &pkt, 1);
+            busy = true;
+            uint64_t t = cycle_now();
             
-            if (nb_tx == 0) {
-                rte_pktmbuf_free(pkt);
-                prof->packets_dropped++;
+            // Build packets
+            uint16_t nb_built = 0;
+            if (rte_pktmbuf_alloc_bulk(pool, pkts, due) == 0) {
+                cycle_stage(cs, TX_STAGE_ALLOC, &t);
+                for (; nb_built < due; nb_built++) build_packet(prof, pkts[nb_built]);
+                cycle_stage(cs, TX_STAGE_BUILD, &t);
             } else {
-                prof->packets_sent++;
-                prof->bytes_sent += prof->packet_size;
+                cs->alloc_failures++;
+                cnt->packets_dropped += due;
+                tx->total.packets_dropped += due;
+                cycle_stage(cs, TX_STAGE_ALLOC, &t);
+            }
+            
+            // Send packets
+            uint16_t nb_tx = nb_built ? rte_eth_tx_burst(tx_port, queue_id, pkts, nb_built) : 0;
+            cycle_stage(cs, TX_STAGE_BURST, &t);
+            
+            if (nb_tx < nb_built) {
+                // Queue full. Reuse the sequence numbers: a local TX drop is
+                // not DUT loss
+                cs->tx_queue_full++;
+                rte_pktmbuf_free_bulk(&pkts[nb_tx], nb_built - nb_tx);
+                cnt->packets_dropped += nb_built - nb_tx;
+                tx->total.packets_dropped += nb_built - nb_tx;
+                prof->sequence_num -= nb_built - nb_tx;
+                if (prof->mac_iterate != MAC_ITER_NONE) {
+                    prof->mac_index = (prof->mac_index + prof->mac_count -
+                                       (nb_built - nb_tx) % prof->mac_count) % prof->mac_count;
+                }
+                cycle_stage(cs, TX_STAGE_FREE, &t);
             }
+            cnt->packets_sent += nb_tx;
+            cnt->bytes_sent += (uint64_t)nb_tx * prof->packet_size;
+            tx->total.packets_sent += nb_tx;
+            tx->total.bytes_sent += (uint64_t)nb_tx * prof->packet_size;
             
-            // CRITICAL FIX: Use pre-calculated cycles to avoid overflow
-            next_send_time[i] = now + prof->inter_packet_gap_cycles;
+            // CRITICAL FIX: Use pre-calculated cycles to avoid overflow.
+            // Schedule from the previous deadline so loop overhead does not
+            // lower the rate; at most TX_MAX_CATCHUP gaps of debt are kept
+            // and the rest is counted as skipped.
+            uint64_t next = next_send_time[i] + due * gap;
+            uint64_t floor = now - TX_MAX_CATCHUP * gap;
+            if (unlikely(next < floor)) {
+                uint64_t skipped = gap ? (floor - next) / gap : 0;
+                cnt->packets_skipped += skipped;
+                tx->total.packets_skipped += skipped;
+                next = floor;
+            }
+            next_send_time[i] = next;
         }
     }
     
@@ -256,256 +689,5441 @@ int tx_thread_main(__rte_unused void *arg) {
     return 0;
 }
 
-// RX thread
-int rx_thread_main(__rte_unused void *arg) {
-    printf("RX thread started on lcore %u\n", rte_lcore_id());
-    
-    struct rte_mbuf *bufs[BURST_SIZE];
-    
-    while (running && !force_quit) {
-        uint16_t nb_rx = rte_eth_rx_burst(rx_port, 0, bufs, BURST_SIZE);
-        
-        if (nb_rx == 0) {
-            continue;
-        }
-        
-        for (int i = 0; i < nb_rx; i++) {
-            rx_statistics.packets_received++;
-            rx_statistics.bytes_received += bufs[i]->pkt_len;
-            rte_pktmbuf_free(bufs[i]);
-        }
+// Clear 'count' window bits starting at bit position 'from' (wraps)
+static inline void seq_window_clear(uint64_t *window, uint32_t from, uint32_t count) {
+    if (count >= SEQ_WINDOW_BITS) {
+        memset(window, 0, SEQ_WINDOW_WORDS * sizeof(uint64_t));
+        return;
     }
     
-    printf("RX thread stopped\n");
-    return 0;
+    while (count > 0) {
+        uint32_t bit = from & 63;
+        uint32_t n = RTE_MIN(64 - bit, count);
+        uint64_t mask = (n == 64) ? ~0ULL : (((1ULL << n) - 1) << bit);
+        window[from >> 6] &= ~mask;
+        count -= n;
+        from = (from + n) & SEQ_WINDOW_MASK;
+    }
 }
 
-// Port initialization
-int init_port(uint16_t port, struct rte_mempool *mbuf_pool, bool enable_rx) {
-    struct rte_eth_conf port_conf = {};
-    port_conf.rxmode.max_lro_pkt_size = RTE_ETHER_MAX_LEN;
-    port_conf.txmode.offloads = RTE_ETH_TX_OFFLOAD_MULTI_SEGS;
+// Highest sequence number seen per stream over all RX queues, as
+// (1 << 32) | seq, 0 before the first packet. Source ports are randomized,
+// so RSS spreads one stream over several queues; a frame overtaken on
+// another queue is only visible against this shared maximum. Duplicates
+// hash like the original and stay with the per-queue window.
+static uint64_t stream_max_seq[MAX_STREAMS] __rte_cache_aligned;
+
+// Raise the stream's shared maximum to 'seq'. False when another queue
+// already saw a later sequence number, i.e. 'seq' arrived out of order.
+static inline bool stream_seq_advance(uint16_t stream_id, uint32_t seq) {
+    uint64_t *max = &stream_max_seq[stream_id];
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
     
-    struct rte_eth_dev_info dev_info;
-    rte_eth_dev_info_get(port, &dev_info);
+    do {
+        if (cur != 0 && (int32_t)(seq - (uint32_t)cur) <= 0) return false;
+    } while (!__atomic_compare_exchange_n(max, &cur, (1ULL << 32) | seq, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return true;
+}
+
+// Classify one received sequence number against the stream's window
+static inline void rx_track_sequence(rx_stream_state *st, uint16_t stream_id, uint32_t seq) {
+    uint64_t *word = &st->window[(seq & SEQ_WINDOW_MASK) >> 6];
+    uint64_t bit = 1ULL << (seq & 63);
     
-    uint16_t nb_rxq = enable_rx ? 1 : 0;
-    uint16_t nb_txq = 1;
+    if (unlikely(!st->seen)) {
+        st->seen = 1;
+        st->max_seq = seq;
+        *word |= bit;
+        if (stream_seq_advance(stream_id, seq)) st->in_order++;
+        else st->out_of_order++;
+        return;
+    }
     
-    int ret = rte_eth_dev_configure(port, nb_rxq, nb_txq, &port_conf);
-    if (ret != 0) return ret;
+    uint32_t ahead = seq - st->max_seq;
+    if (likely(ahead != 0 && ahead < 0x80000000u)) {
+        // New highest sequence on this queue: expire the slots we are moving over
+        seq_window_clear(st->window, (st->max_seq + 1) & SEQ_WINDOW_MASK, ahead);
+        st->max_seq = seq;
+        *word |= bit;
+        if (likely(stream_seq_advance(stream_id, seq))) st->in_order++;
+        else st->out_of_order++;
+        return;
+    }
     
-    // Setup RX queue if enabled
-    if (enable_rx) {
-        ret = rte_eth_rx_queue_setup(port, 0, RX_RING_SIZE,
-                                     rte_eth_dev_socket_id(port),
-                                     NULL, mbuf_pool);
-        if (ret < 0) return ret;
+    uint32_t behind = st->max_seq - seq;
+    if (behind >= SEQ_WINDOW_BITS) {
+        st->late_arrivals++;
+    } else if (*word & bit) {
+        st->duplicates++;
+    } else {
+        *word |= bit;
+        st->out_of_order++;
     }
+}
+
+// Locate the NetGen signature in a received frame (UDP over IPv4, optional VLAN)
+static inline const struct netgen_signature* rx_find_signature(struct rte_mbuf *m) {
+    const uint8_t *data = rte_pktmbuf_mtod(m, const uint8_t*);
+    uint16_t len = rte_pktmbuf_data_len(m);
+    uint16_t offset = sizeof(struct rte_ether_hdr);
     
-    // Setup TX queue
-    struct rte_eth_txconf txconf = dev_info.default_txconf;
-    txconf.offloads = port_conf.txmode.offloads;
-    ret = rte_eth_tx_queue_setup(port, 0, TX_RING_SIZE,
-                                 rte_eth_dev_socket_id(port),
-                                 &txconf);
-    if (ret < 0) return ret;
+    if (unlikely(len < PAYLOAD_OFFSET + sizeof(struct netgen_signature))) return NULL;
     
-    // CRITICAL: Start the port!
-    ret = rte_eth_dev_start(port);
-    if (ret < 0) {
-        printf("ERROR: Failed to start port %u: %d\n", port, ret);
-        return ret;
+    uint16_t ether_type = ((const struct rte_ether_hdr*)data)->ether_type;
+    if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_VLAN)) {
+        ether_type = ((const struct rte_vlan_hdr*)(data + offset))->eth_proto;
+        offset += sizeof(struct rte_vlan_hdr);
     }
-    printf("✓ Port %u STARTED\n", port);
+    if (ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) return NULL;
     
-    rte_eth_promiscuous_enable(port);
+    const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr*)(data + offset);
+    if (ip->next_proto_id != IPPROTO_UDP) return NULL;
+    offset += (ip->version_ihl & RTE_IPV4_HDR_IHL_MASK) * RTE_IPV4_IHL_MULTIPLIER;
+    offset += sizeof(struct rte_udp_hdr);
     
-    printf("Port %u initialized (%s mode)\n", port, enable_rx ? "RX+TX" : "TX only");
+    if (unlikely(offset + sizeof(struct netgen_signature) > len)) return NULL;
     
-    return 0;
+    const struct netgen_signature *sig = (const struct netgen_signature*)(data + offset);
+    if (sig->magic != NETGEN_SIG_MAGIC || sig->stream_id >= MAX_STREAMS) return NULL;
+    
+    return sig;
 }
 
-// Control socket command handler
-void handle_control_command(int client_sock, const char *cmd_json) {
-    struct json_object *root = json_tokener_parse(cmd_json);
-    if (!root) {
-        const char *error = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}\n";
-        send(client_sock, error, strlen(error), 0);
-        return;
+// Take one (TSC, NIC clock) anchor; the TSC is the midpoint of the read
+static int nic_clock_sample(uint16_t port, uint64_t *tsc, uint64_t *nic) {
+    uint64_t before = rte_rdtsc();
+    int ret = rte_eth_read_clock(port, nic);
+    uint64_t after = rte_rdtsc();
+    
+    *tsc = before + (after - before) / 2;
+    return ret;
+}
+
+// Re-anchor the clock mapping and refine the rate over the whole baseline
+static void nic_clock_resync(uint16_t port, nic_clock_sync *clk) {
+    uint64_t tsc, nic;
+    if (nic_clock_sample(port, &tsc, &nic) != 0) return;
+    
+    if (clk->tsc_base == 0 || tsc <= clk->tsc_base || nic <= clk->nic_base) {
+        clk->tsc_base = tsc;
+        clk->nic_base = nic;
+    } else {
+        double nic_per_tsc = (double)(nic - clk->nic_base) / (double)(tsc - clk->tsc_base);
+        double nic_hz = nic_per_tsc * rte_get_tsc_hz();
+        clk->nic_per_tsc_fp = (uint64_t)(nic_per_tsc * 4294967296.0);
+        clk->ns_per_nic_fp = (uint64_t)(1e9 / nic_hz * 4294967296.0);
+        clk->valid = true;
     }
     
-    struct json_object *cmd_obj;
-    if (!json_object_object_get_ex(root, "command", &cmd_obj)) {
-        const char *error = "{\"status\":\"error\",\"message\":\"No command specified\"}\n";
-        send(client_sock, error, strlen(error), 0);
-        json_object_put(root);
-        return;
+    clk->tsc_ref = tsc;
+    clk->nic_ref = nic;
+}
+
+// Latency of one packet in ns; NIC RX timestamp when present, TSC otherwise
+static inline uint64_t rx_latency_ns(const nic_clock_sync *clk, struct rte_mbuf *m,
+                                     uint64_t tx_tsc, uint64_t rx_tsc, bool *hw) {
+    if (rx_hw_timestamp && clk->valid && (m->ol_flags & hwts_dynflag)) {
+        uint64_t rx_nic = *RTE_MBUF_DYNFIELD(m, hwts_dynfield_offset, rte_mbuf_timestamp_t*);
+        int64_t dt = (int64_t)(tx_tsc - clk->tsc_ref);
+        int64_t tx_nic = (int64_t)clk->nic_ref +
+                         (int64_t)(((__int128)dt * (int64_t)clk->nic_per_tsc_fp) >> 32);
+        int64_t ticks = (int64_t)rx_nic - tx_nic;
+        
+        *hw = true;
+        return ticks > 0 ? (uint64_t)(((unsigned __int128)ticks * clk->ns_per_nic_fp) >> 32) : 0;
     }
     
-    const char *command = json_object_get_string(cmd_obj);
+    *hw = false;
+    return rx_tsc > tx_tsc ?
+           (uint64_t)(((unsigned __int128)(rx_tsc - tx_tsc) * tsc_ns_fp) >> 32) : 0;
+}
+
+static inline uint32_t lat_hist_index(uint64_t ns) {
+    if (ns < LAT_HIST_SUB) return (uint32_t)ns;
     
-    if (strcmp(command, "start") == 0) {
-        // Create default traffic profile if none exist
-        if (num_profiles == 0) {
-            RTE_LOG(INFO, USER1, "No profiles configured, creating default profile\n");
-            
-            traffic_profile *prof = &profiles[0];
-            memset(prof, 0, sizeof(traffic_profile));
-            
-            strcpy(prof->name, "default");
-            prof->dst_ip = 0xC0A80202;           // 192.168.2.2
-            prof->use_ipv6 = false;
-            
-            prof->src_port_min = 10000;
-            prof->src_port_max = 10100;
-            prof->dst_port = 5000;
-            
-            prof->protocol = PROTO_UDP;
-            prof->packet_size = 1400;
-            prof->rate_mbps = 100.0;
-            prof->burst_size = 32;
-            
-            // Calculate inter-packet gap for ~100 Mbps with 1400 byte packets
-            // Formula: IPG (ns) = (packet_size * 8 * 1000) / rate_mbps
-            prof->inter_packet_gap_ns = (prof->packet_size * 8 * 1000) / prof->rate_mbps;
-            
-            // CRITICAL FIX: Pre-calculate TSC cycles to prevent overflow in TX loop
-            uint64_t tsc_hz = rte_get_tsc_hz();
-            prof->inter_packet_gap_cycles = (prof->inter_packet_gap_ns * tsc_hz) / 1000000000ULL;
-            
-            RTE_LOG(INFO, USER1, "  Inter-packet gap: %lu ns = %lu cycles (@ %lu Hz)\n",
-                    prof->inter_packet_gap_ns, prof->inter_packet_gap_cycles, tsc_hz);
-            
-            prof->vlan_enabled = false;
-            prof->vlan_id = 0;
-            prof->dscp = 0;
-            
-            prof->payload_type = PAYLOAD_INCREMENT;
-            prof->custom_payload_len = 0;
-            
-            prof->sequence_num = 0;
-            prof->stream_id = 1;
-            prof->packets_sent = 0;
-            prof->bytes_sent = 0;
-            prof->packets_dropped = 0;
-            
-            num_profiles = 1;
-            
-            RTE_LOG(INFO, USER1, "✓ Created default profile: UDP 192.168.1.1 -> 192.168.2.2:%u, %u bytes @ %.1f Mbps\n",
-                    prof->dst_port, prof->packet_size, prof->rate_mbps);
-        }
-        
-        running = true;
-        rte_eal_mp_remote_launch(tx_thread_main, NULL, SKIP_MAIN);
-        if (dual_port_mode) {
-            rte_eal_mp_remote_launch(rx_thread_main, NULL, SKIP_MAIN);
-        }
-        
-        const char *response = "{\"status\":\"success\",\"message\":\"Started\"}\n";
-        send(client_sock, response, strlen(response), 0);
-        
-    } else if (strcmp(command, "stop") == 0) {
-        running = false;
-        rte_eal_mp_wait_lcore();
-        
-        const char *response = "{\"status\":\"success\",\"message\":\"Stopped\"}\n";
-        send(client_sock, response, strlen(response), 0);
-        
-    } else if (strcmp(command, "stats") == 0) {
-        char stats_json[4096];
-        uint64_t total_tx = 0, total_bytes = 0;
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    uint32_t idx = (msb - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB +
+                   ((ns >> (msb - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB - 1));
+    return RTE_MIN(idx, LAT_HIST_BUCKETS - 1);
+}
+
+// Midpoint of a histogram bucket in ns (control path only)
+static uint64_t lat_hist_value(uint32_t idx) {
+    if (idx < LAT_HIST_SUB) return idx;
+    
+    uint32_t shift = idx / LAT_HIST_SUB - 1;
+    uint64_t lower = (uint64_t)(LAT_HIST_SUB + idx % LAT_HIST_SUB) << shift;
+    return lower + ((1ULL << shift) >> 1);
+}
+
+static inline void rx_track_latency(rx_stream_state *st, uint64_t latency_ns, bool hw,
+                                    bool in_order) {
+    if (st->latency_count > 0) {
+        // RFC 3550: D = difference of transit times, J += (|D| - J) / 16
+        int64_t d = (int64_t)(latency_ns - st->last_latency_ns);
+        uint64_t abs_d = d < 0 ? -d : d;
+        st->jitter_q4 += abs_d - ((st->jitter_q4 + 8) >> 4);
         
-        for (int i = 0; i < num_profiles; i++) {
-            total_tx += profiles[i].packets_sent;
-            total_bytes += profiles[i].bytes_sent;
+        // RFC 5481 IPDV between successive in-order packets
+        if (in_order) {
+            if (st->ipdv_count == 0 || d < st->ipdv_min_ns) st->ipdv_min_ns = d;
+            if (st->ipdv_count == 0 || d > st->ipdv_max_ns) st->ipdv_max_ns = d;
+            st->ipdv_abs_sum_ns += abs_d;
+            st->ipdv_count++;
         }
-        
-        snprintf(stats_json, sizeof(stats_json),
-                "{\"status\":\"success\",\"data\":{"
-                "\"packets_sent\":%lu,"
-                "\"bytes_sent\":%lu,"
-                "\"packets_received\":%lu,"
-                "\"bytes_received\":%lu,"
-                "\"throughput_mbps\":%.2f"
-                "}}\n",
-                total_tx, total_bytes,
-                rx_statistics.packets_received, rx_statistics.bytes_received,
-                (total_bytes * 8.0) / 1000000.0);
-        
-        send(client_sock, stats_json, strlen(stats_json), 0);
-        
-    } else {
-        const char *error = "{\"status\":\"error\",\"message\":\"Unknown command\"}\n";
-        send(client_sock, error, strlen(error), 0);
     }
+    st->last_latency_ns = latency_ns;
     
-    json_object_put(root);
+    if (st->latency_count == 0 || latency_ns < st->latency_min_ns) st->latency_min_ns = latency_ns;
+    if (latency_ns > st->latency_max_ns) st->latency_max_ns = latency_ns;
+    st->latency_sum_ns += latency_ns;
+    st->latency_count++;
+    st->hw_timestamps += hw;
+    st->latency_hist[lat_hist_index(latency_ns)]++;
 }
 
-// Control socket thread
-void* control_socket_thread(void *arg) {
-    const char *socket_path = (const char*)arg;
+// Move this queue to the bucket containing 'now'
+static void microburst_advance(rx_lcore_state *state, uint64_t now) {
+    uint64_t id = (now - microburst.epoch_tsc) / microburst.bucket_cycles;
+    microburst_bucket *slot = &state->mb_ring[id & (MICROBURST_RING_SIZE - 1)];
     
-    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
-    struct sockaddr_un addr = {};
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    slot->bytes = 0;
+    rte_smp_wmb();
+    slot->id = id;
     
-    unlink(socket_path);
+    state->mb_slot = slot;
+    state->mb_bucket_end = microburst.epoch_tsc + (id + 1) * microburst.bucket_cycles;
+}
+
+static void microburst_close(uint64_t end_bucket) {
+    uint64_t bucket_ns = (uint64_t)microburst_cfg.bucket_us * 1000;
+    microburst_event *ev = &microburst.log[microburst.log_head % MICROBURST_LOG_SIZE];
     
-    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        perror("bind");
-        return NULL;
-    }
+    ev->start_ns = microburst.burst_start * bucket_ns;
+    ev->duration_ns = (end_bucket - microburst.burst_start) * bucket_ns;
+    ev->peak_bytes = microburst.burst_peak;
+    ev->peak_pct = (uint32_t)(microburst.burst_peak * 100 / microburst.line_bytes);
     
-    listen(sock, 5);
-    printf("Control socket listening on %s\n", socket_path);
+    microburst.log_head++;
+    microburst.count++;
+    microburst.max_duration_ns = RTE_MAX(microburst.max_duration_ns, ev->duration_ns);
+    microburst.in_burst = false;
+}
+
+// Merge closed buckets of all RX queues and run burst detection (queue 0 lcore)
+static void microburst_scan(uint64_t now) {
+    uint64_t current = (now - microburst.epoch_tsc) / microburst.bucket_cycles;
     
-    while (!force_quit) {
-        int client = accept(sock, NULL, NULL);
-        if (client == -1) continue;
+    // History older than the rings has been overwritten
+    if (current - microburst.next_bucket > MICROBURST_RING_SIZE / 2) {
+        if (microburst.in_burst) microburst_close(microburst.next_bucket);
+        microburst.next_bucket = current - MICROBURST_RING_SIZE / 2;
+    }
+    
+    // Leave one bucket of margin for queues still filling the previous one
+    for (uint64_t b = microburst.next_bucket; b + 1 < current; b++) {
+        uint64_t bytes = 0;
         
-        char buffer[8192];
-        ssize_t n = recv(client, buffer, sizeof(buffer) - 1, 0);
-        if (n > 0) {
-            buffer[n] = '\0';
-            handle_control_command(client, buffer);
+        for (unsigned q = 0; q < num_rx_lcores; q++) {
+            const microburst_bucket *slot = &rx_queue_states[q]->mb_ring[b & (MICROBURST_RING_SIZE - 1)];
+            if (slot->id == b) bytes += slot->bytes;
         }
         
-        close(client);
+        if (bytes >= microburst.threshold_bytes) {
+            if (!microburst.in_burst) {
+                microburst.in_burst = true;
+                microburst.burst_start = b;
+                microburst.burst_peak = 0;
+            }
+            microburst.burst_peak = RTE_MAX(microburst.burst_peak, bytes);
+        } else if (microburst.in_burst) {
+            microburst_close(b);
+        }
+        
+        microburst.next_bucket = b + 1;
     }
-    
-    close(sock);
-    unlink(socket_path);
-    return NULL;
 }
 
-// Main
-int main(int argc, char *argv[]) {
-    signal(SIGINT, [](int){force_quit = true;});
-    signal(SIGTERM, [](int){force_quit = true;});
+// Reset detector state and derive the threshold from the RX link speed
+// (control thread, before the RX lcores are launched)
+void microburst_reset(void) {
+    struct rte_eth_link link = {};
+    uint64_t link_mbps = 10000;
     
-    const char *control_socket = "/tmp/dpdk_engine_control.sock";
+    if (rte_eth_link_get_nowait(rx_port, &link) == 0 &&
+        link.link_speed != RTE_ETH_SPEED_NUM_NONE &&
+        link.link_speed != RTE_ETH_SPEED_NUM_UNKNOWN) {
+        link_mbps = link.link_speed;
+    } else {
+        printf("WARNING: RX link speed unknown, microburst threshold assumes 10 Gbps\n");
+    }
     
-    // Initialize DPDK
-    int ret = rte_eal_init(argc, argv);
-    if (ret < 0) {
-        fprintf(stderr, "Failed to initialize DPDK\n");
-        return -1;
+    uint32_t bucket_us = microburst_cfg.bucket_us;
+    uint64_t epoch = rte_rdtsc();
+    memset(&microburst, 0, sizeof(microburst));
+    microburst.epoch_tsc = epoch;
+    microburst.bucket_cycles = rte_get_tsc_hz() / 1000000 * bucket_us;
+    microburst.line_bytes = RTE_MAX(link_mbps * bucket_us / 8, (uint64_t)1);
+    microburst.threshold_bytes = RTE_MAX(microburst.line_bytes * microburst_cfg.threshold_pct / 100,
+                                         (uint64_t)1);
+    
+    for (unsigned q = 0; q < num_rx_lcores; q++) {
+        rx_lcore_state *state = rx_queue_states[q];
+        memset(state->mb_ring, 0xFF, MICROBURST_RING_SIZE * sizeof(microburst_bucket));
+        state->mb_slot = &state->mb_ring[0];
+        state->mb_bucket_end = 0;
     }
+}
+
+// Extract the flow key of one frame; false for non-IPv4 traffic
+static inline bool flow_parse(struct rte_mbuf *m, flow_key *key) {
+    const uint8_t *data = rte_pktmbuf_mtod(m, const uint8_t*);
+    uint16_t len = rte_pktmbuf_data_len(m);
+    uint16_t offset = sizeof(struct rte_ether_hdr);
     
-    // Check ports
-    uint16_t nb_ports = rte_eth_dev_count_avail();
-    printf("Found %u DPDK ports\n", nb_ports);
+    memset(key, 0, sizeof(*key));
+    if (unlikely(len < sizeof(struct rte_ether_hdr) + sizeof(struct rte_ipv4_hdr))) return false;
     
-    if (nb_ports == 0) {
-        fprintf(stderr, "No DPDK ports available\n");
-        return -1;
+    uint16_t ether_type = ((const struct rte_ether_hdr*)data)->ether_type;
+    if (m->ol_flags & RTE_MBUF_F_RX_VLAN_STRIPPED) {
+        key->vlan_id = m->vlan_tci & 0xFFF;
+    } else if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_VLAN)) {
+        const struct rte_vlan_hdr *vlan = (const struct rte_vlan_hdr*)(data + offset);
+        key->vlan_id = rte_be_to_cpu_16(vlan->vlan_tci) & 0xFFF;
+        ether_type = vlan->eth_proto;
+        offset += sizeof(struct rte_vlan_hdr);
     }
+    if (ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) return false;
+    if (unlikely(offset + sizeof(struct rte_ipv4_hdr) > len)) return false;
     
-    tx_port = 0;
-    dual_port_mode = (nb_ports >= 2);
+    const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr*)(data + offset);
+    uint32_t ihl = ip->version_ihl & RTE_IPV4_HDR_IHL_MASK;
+    if (unlikely(ihl < 5)) return false;
+    key->src_ip = ip->src_addr;
+    key->dst_ip = ip->dst_addr;
+    key->proto = ip->next_proto_id;
+    offset += ihl * RTE_IPV4_IHL_MULTIPLIER;
+    
+    if ((key->proto == IPPROTO_UDP || key->proto == IPPROTO_TCP) && offset + 4u <= len) {
+        const uint16_t *ports = (const uint16_t*)(data + offset);
+        key->src_port = ports[0];
+        key->dst_port = ports[1];
+    }
+    return true;
+}
+
+// Parse the flow keys of a whole RX burst; returns the number of IPv4 frames
+static inline uint32_t flow_parse_burst(struct rte_mbuf **bufs, uint16_t nb_rx,
+                                        flow_key *keys, uint32_t *lens) {
+    uint32_t n = 0;
+    
+    for (uint16_t i = 0; i < nb_rx; i++) {
+        if (flow_parse(bufs[i], &keys[n])) {
+            lens[n] = bufs[i]->pkt_len;
+            n++;
+        }
+    }
+    return n;
+}
+
+// Account one RX burst in the flow table with a single bulk lookup
+static void flow_account_burst(rx_lcore_state *state, const flow_key *keys,
+                               const uint32_t *lens, uint32_t n) {
+    const void *key_ptrs[BURST_SIZE];
+    int32_t positions[BURST_SIZE];
+    
+    for (uint32_t i = 0; i < n; i++) key_ptrs[i] = &keys[i];
+    
+    rte_hash_lookup_bulk(state->flow_hash, key_ptrs, n, positions);
+    
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t pos = positions[i];
+        
+        if (unlikely(pos < 0)) {
+            pos = rte_hash_add_key(state->flow_hash, key_ptrs[i]);
+            if (pos < 0) {
+                state->flow_table_full++;
+                continue;
+            }
+            state->flows[pos].key = keys[i];
+        }
+        
+        state->flows[pos].packets++;
+        state->flows[pos].bytes += lens[i];
+    }
+}
+
+// MurmurHash3 64-bit finalizer
+static inline uint64_t fmix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 64-bit flow hash over the 16-byte key: CRC32C in the low half, a
+// multiplicative mix in the high half. The halves must be independent:
+// two CRC32C passes with different seeds differ by a key-independent
+// constant (CRC is affine in its seed), which would collapse the
+// Count-Min rows h1 + d*h2 into one.
+static inline uint64_t flow_hash64(const flow_key *key) {
+    uint64_t k[2];
+    memcpy(k, key, sizeof(k));
+    
+    uint32_t lo = rte_hash_crc_8byte(k[0], rte_hash_crc_8byte(k[1], 0x9E3779B9));
+    uint32_t hi = (uint32_t)(fmix64(k[0] ^ fmix64(k[1] ^ 0x9E3779B97F4A7C15ULL)) >> 32);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t cms_estimate(uint64_t (*cms)[CMS_WIDTH], uint64_t h) {
+    uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1;
+    uint64_t est = UINT64_MAX;
+    
+    for (uint32_t d = 0; d < CMS_DEPTH; d++) {
+        est = RTE_MIN(est, cms[d][(h1 + d * h2) & (CMS_WIDTH - 1)]);
+    }
+    return est;
+}
+
+static void topk_offer(flow_sketch *sk, const flow_key *key, uint64_t estimate) {
+    uint32_t victim = 0;
+    
+    for (uint32_t i = 0; i < TOPK_SIZE; i++) {
+        if (memcmp(&sk->topk[i].key, key, sizeof(*key)) == 0) {
+            sk->topk[i].estimate = estimate;
+            victim = TOPK_SIZE;
+            break;
+        }
+        if (sk->topk[i].estimate < sk->topk[victim].estimate) victim = i;
+    }
+    
+    if (victim < TOPK_SIZE) {
+        sk->topk[victim].key = *key;
+        sk->topk[victim].estimate = estimate;
+    }
+    
+    uint64_t min = UINT64_MAX;
+    for (uint32_t i = 0; i < TOPK_SIZE; i++) min = RTE_MIN(min, sk->topk[i].estimate);
+    sk->topk_min = min;
+}
+
+// Update HLL, Count-Min and top-K for one burst of parsed keys
+static void sketch_update_burst(flow_sketch *sk, const flow_key *keys, uint32_t n) {
+    uint64_t hashes[BURST_SIZE];
+    
+    for (uint32_t i = 0; i < n; i++) hashes[i] = flow_hash64(&keys[i]);
+    
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t h = hashes[i];
+        
+        // HyperLogLog: top bits pick the register, rank of the rest
+        uint32_t reg = h >> (64 - HLL_PRECISION);
+        uint8_t rank = __builtin_clzll((h << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1))) + 1;
+        if (rank > sk->hll[reg]) sk->hll[reg] = rank;
+        
+        // Count-Min with double hashing across rows
+        uint32_t h1 = (uint32_t)h, h2 = (uint32_t)(h >> 32) | 1;
+        uint64_t est = UINT64_MAX;
+        for (uint32_t d = 0; d < CMS_DEPTH; d++) {
+            uint64_t c = ++sk->cms[d][(h1 + d * h2) & (CMS_WIDTH - 1)];
+            est = RTE_MIN(est, c);
+        }
+        
+        if (unlikely(est >= sk->topk_min && (est & (TOPK_STRIDE - 1)) == 0)) {
+            topk_offer(sk, &keys[i], est);
+        }
+    }
+    
+    sk->packets += n;
+}
+
+// Create the flow table of one RX queue (called from assign_lcore_roles)
+static int flow_table_create(unsigned lcore_id, rx_lcore_state *state) {
+    char name[32];
+    snprintf(name, sizeof(name), "flow_table_%u", lcore_id);
+    
+    struct rte_hash_parameters params = {};
+    params.name = name;
+    params.entries = flow_table_entries;
+    params.key_len = sizeof(flow_key);
+    params.hash_func = rte_hash_crc;
+    params.hash_func_init_val = 0;
+    params.socket_id = rte_lcore_to_socket_id(lcore_id);
+    params.extra_flag = RTE_HASH_EXTRA_FLAGS_EXT_TABLE;
+    
+    state->flow_hash = rte_hash_create(&params);
+    if (!state->flow_hash) {
+        fprintf(stderr, "Failed to create flow table for lcore %u\n", lcore_id);
+        return -1;
+    }
+    
+    state->flows = (flow_entry*)rte_zmalloc_socket("flow_entries",
+                                                   (size_t)flow_table_entries * sizeof(flow_entry),
+                                                   RTE_CACHE_LINE_SIZE, params.socket_id);
+    if (!state->flows) {
+        fprintf(stderr, "Failed to allocate %u flow entries for lcore %u\n",
+                flow_table_entries, lcore_id);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Allocate the flow sketches of one RX queue (called from assign_lcore_roles)
+static int flow_sketch_create(unsigned lcore_id, rx_lcore_state *state) {
+    state->sketch = (flow_sketch*)rte_zmalloc_socket("flow_sketch", sizeof(flow_sketch),
+                                                     RTE_CACHE_LINE_SIZE,
+                                                     rte_lcore_to_socket_id(lcore_id));
+    if (!state->sketch) {
+        fprintf(stderr, "Failed to allocate flow sketches for lcore %u\n", lcore_id);
+        return -1;
+    }
+    return 0;
+}
+
+#define CDP_MULTICAST 0x01000CCCCCCCULL
+#define CDP_FRAME 0x2000                // CDP SNAP protocol id
+
+static void topology_input(uint16_t port, struct rte_mbuf *m, bool cdp);
+static inline void mp_capture(uint16_t port, struct rte_mbuf *m);
+
+// Early classification for frames without a test signature: ARP, LLDP or
+// CDP (802.3 length + SNAP to the CDP multicast address), else 0
+static inline int control_frame_type(struct rte_mbuf *m) {
+    const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, const struct rte_ether_hdr*);
+    if (eth->ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP)) return RTE_ETHER_TYPE_ARP;
+    if (eth->ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_LLDP)) return RTE_ETHER_TYPE_LLDP;
+    if (rte_be_to_cpu_16(eth->ether_type) <= RTE_ETHER_MTU &&
+        mac_to_u64(eth->dst_addr.addr_bytes) == CDP_MULTICAST) {
+        return CDP_FRAME;
+    }
+    return 0;
+}
+
+// RX thread
+int rx_thread_main(__rte_unused void *arg) {
+    unsigned lcore_id = rte_lcore_id();
+    rx_lcore_state *state = lcore_confs[lcore_id].rx;
+    uint16_t queue_id = lcore_confs[lcore_id].queue_id;
+    printf("RX thread started on lcore %u (queue %u)\n", lcore_id, queue_id);
+    
+    struct rte_mbuf *bufs[BURST_SIZE];
+    nic_clock_sync *clk = &state->clock;
+    uint64_t resync_cycles = rte_get_tsc_hz() / 1000 * NIC_CLOCK_RESYNC_MS;
+    
+    if (rx_hw_timestamp && !clk->valid) {
+        *clk = nic_clock_nominal;
+    }
+    
+    bool mb_detector = (queue_id == 0);
+    uint64_t mb_scan_cycles = rte_get_tsc_hz() / 1000000 * MICROBURST_SCAN_US;
+    uint64_t mb_next_scan = 0;
+    
+    lcore_cycle_stats *cs = &state->cycles;
+    uint64_t poll_start = cycle_now();
+    bool busy = false;
+    
+    while (running && !force_quit) {
+        uint64_t poll_now = cycle_now();
+        cycle_poll(cs, busy, poll_start, poll_now);
+        poll_start = poll_now;
+        
+        uint16_t nb_rx = rte_eth_rx_burst(rx_port, queue_id, bufs, BURST_SIZE);
+        busy = nb_rx > 0;
+        
+        if (mb_detector) {
+            uint64_t now = rte_rdtsc();
+            if (now >= mb_next_scan) {
+                microburst_scan(now);
+                mb_next_scan = now + mb_scan_cycles;
+            }
+        }
+        
+        if (nb_rx == 0) {
+            continue;
+        }
+        
+        uint64_t rx_tsc = rte_rdtsc();
+        if (rx_hw_timestamp && rx_tsc - clk->tsc_ref > resync_cycles) {
+            nic_clock_resync(rx_port, clk);
+        }
+        if (unlikely(rx_tsc >= state->mb_bucket_end)) {
+            microburst_advance(state, rx_tsc);
+        }
+        
+        uint64_t burst_bytes = 0;
+        for (int i = 0; i < nb_rx; i++) {
+            state->packets_received++;
+            state->bytes_received += bufs[i]->pkt_len;
+            burst_bytes += bufs[i]->pkt_len + ETHER_WIRE_OVERHEAD;
+            
+            const struct netgen_signature *sig = rx_find_signature(bufs[i]);
+            if (sig) {
+                rx_stream_state *st = &state->streams[sig->stream_id];
+                uint64_t in_order_before = st->in_order;
+                rx_track_sequence(st, sig->stream_id, sig->seq);
+                st->bytes += bufs[i]->pkt_len;
+                
+                bool hw;
+                uint64_t latency = rx_latency_ns(clk, bufs[i], sig->tx_tsc, rx_tsc, &hw);
+                rx_track_latency(st, latency, hw, st->in_order != in_order_before);
+            } else {
+                state->unsigned_packets++;
+                if (unlikely(control_frame_type(bufs[i]) != 0) && arp_ring != NULL) {
+                    // The resolver frees its reference after handling it
+                    rte_mbuf_refcnt_update(bufs[i], 1);
+                    if (rte_ring_mp_enqueue(arp_ring, bufs[i]) != 0) {
+                        rte_mbuf_refcnt_update(bufs[i], -1);
+                    }
+                }
+                mp_capture(rx_port, bufs[i]);
+            }
+        }
+        
+        state->mb_slot->bytes += burst_bytes;
+        
+        if (state->flow_hash || state->sketch) {
+            flow_key keys[BURST_SIZE];
+            uint32_t lens[BURST_SIZE];
+            uint32_t n = flow_parse_burst(bufs, nb_rx, keys, lens);
+            
+            if (n > 0 && state->flow_hash) flow_account_burst(state, keys, lens, n);
+            if (n > 0 && state->sketch) sketch_update_burst(state->sketch, keys, n);
+        }
+        
+        rte_pktmbuf_free_bulk(bufs, nb_rx);
+    }
+    
+    printf("RX thread stopped\n");
+    return 0;
+}
+
+// Per-lcore entry point: dispatch on the role assigned at startup
+int lcore_main(void *arg) {
+    switch (lcore_confs[rte_lcore_id()].role) {
+        case LCORE_ROLE_TX: return tx_thread_main(arg);
+        case LCORE_ROLE_RX: return rx_thread_main(arg);
+        default:            return 0;
+    }
+}
+
+// NUMA socket of a port. Virtual devices report SOCKET_ID_ANY and use the
+// main lcore's socket.
+static int port_socket(uint16_t port) {
+    int socket = rte_eth_dev_socket_id(port);
+    return socket < 0 || socket >= RTE_MAX_NUMA_NODES ? (int)rte_socket_id() : socket;
+}
+
+static inline struct rte_mempool* port_pool(uint16_t port) {
+    return socket_pools[port_socket(port)];
+}
+
+// Queues and descriptors of a port, fixed before the pools are sized
+struct port_plan {
+    uint16_t nb_rxq;
+    uint16_t nb_txq;
+    uint16_t nb_rxd;
+    uint16_t nb_txd;
+};
+
+static port_plan port_plans[RTE_MAX_ETHPORTS];
+
+// Descriptor counts within the driver's limits (dev_info desc_lim). The
+// RX queue of tx_port only sees control frames and stays small.
+static int plan_port(uint16_t port, uint16_t nb_rxq, uint16_t nb_txq) {
+    port_plan *pp = &port_plans[port];
+    pp->nb_rxq = nb_rxq;
+    pp->nb_txq = nb_txq;
+    pp->nb_rxd = port == rx_port && dual_port_mode ? RTE_MIN(rxd_requested ? rxd_requested : RX_RING_SIZE, UINT16_MAX)
+                                                   : ARP_RX_RING_SIZE;
+    pp->nb_txd = RTE_MIN(txd_requested ? txd_requested : TX_RING_SIZE, UINT16_MAX);
+    
+    int ret = rte_eth_dev_adjust_nb_rx_tx_desc(port, &pp->nb_rxd, &pp->nb_txd);
+    if (ret != 0) {
+        fprintf(stderr, "Port %u: cannot adjust descriptor counts: %d\n", port, ret);
+        return -1;
+    }
+    return 0;
+}
+
+// Mbufs one socket's pool must cover: every descriptor of its ports, the
+// caches and in-flight bursts of the lcores serving them, and the control
+// rings holding frames from them
+static uint32_t socket_pool_need(int socket) {
+    int ports[2] = {tx_port, rx_port};
+    int nb_ports = dual_port_mode ? 2 : 1;
+    uint64_t need = 0;
+    
+    for (int i = 0; i < nb_ports; i++) {
+        if (port_socket(ports[i]) != socket) continue;
+        const port_plan *pp = &port_plans[ports[i]];
+        need += (uint64_t)pp->nb_rxq * pp->nb_rxd + (uint64_t)pp->nb_txq * pp->nb_txd;
+        if (arp_enabled) {
+            need += 2 * NETGEN_MP_RING_SIZE + BURST_SIZE;   // Inject/capture rings, resolver burst
+            if (ports[i] == rx_port) need += ARP_RING_SIZE;
+        }
+    }
+    
+    unsigned lcore_id;
+    RTE_LCORE_FOREACH_WORKER(lcore_id) {
+        const lcore_conf *conf = &lcore_confs[lcore_id];
+        if (conf->role == LCORE_ROLE_IDLE) continue;
+        
+        uint16_t port = conf->role == LCORE_ROLE_RX ? rx_port : tx_port;
+        if (port_socket(port) != socket) continue;
+        // A cache holds up to 1.5x its size before flushing
+        need += mbuf_cache_size * 3 / 2 + (conf->role == LCORE_ROLE_RX ? BURST_SIZE : TX_MAX_CATCHUP);
+    }
+    return need > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)need;
+}
+
+// One mbuf pool per socket that has a port in use, so RX descriptors, TX
+// frames and control frames never cross the interconnect. Pools are sized
+// to the next 2^n - 1 above their need, at least NUM_MBUFS.
+static int create_socket_pools(void) {
+    int ports[2] = {tx_port, rx_port};
+    int nb_ports = dual_port_mode ? 2 : 1;
+    
+    mbuf_cache_size = RTE_MIN(mbuf_cache_size, (unsigned)RTE_MEMPOOL_CACHE_MAX_SIZE);
+    
+    for (int i = 0; i < nb_ports; i++) {
+        int socket = port_socket(ports[i]);
+        if (socket_pools[socket]) continue;
+        
+        uint32_t need = socket_pool_need(socket);
+        uint32_t nb_mbufs = RTE_MAX(rte_align32pow2(need + 1) - 1, (uint32_t)NUM_MBUFS);
+        if (mbufs_requested) {
+            if (mbufs_requested < need) {
+                printf("WARNING: --mbufs %u is below the %u mbufs socket %d needs, expect allocation failures\n",
+                       mbufs_requested, need, socket);
+            }
+            nb_mbufs = mbufs_requested;
+        }
+        
+        char name[RTE_MEMPOOL_NAMESIZE];
+        snprintf(name, sizeof(name), "MBUF_POOL_S%d", socket);
+        socket_pools[socket] = rte_pktmbuf_pool_create(name, nb_mbufs, mbuf_cache_size, 0,
+                                                       RTE_MBUF_DEFAULT_BUF_SIZE, socket);
+        if (!socket_pools[socket]) {
+            fprintf(stderr, "Failed to create mbuf pool of %u mbufs on socket %d (hugepages? --mbufs)\n",
+                    nb_mbufs, socket);
+            return -1;
+        }
+        printf("Mbuf pool %s: %u mbufs (%u needed), cache %u, on socket %d\n",
+               name, nb_mbufs, need, mbuf_cache_size, socket);
+    }
+    
+    unsigned lcore_id;
+    RTE_LCORE_FOREACH_WORKER(lcore_id) {
+        lcore_conf *conf = &lcore_confs[lcore_id];
+        if (conf->role == LCORE_ROLE_IDLE) continue;
+        conf->pool = port_pool(conf->role == LCORE_ROLE_RX ? rx_port : tx_port);
+    }
+    return 0;
+}
+
+// Split worker lcores into TX and RX roles and allocate RX analysis state.
+// RX gets one lcore per RSS queue (--rx-queues, default half the workers);
+// every remaining worker owns one TX queue on tx_port. Workers on rx_port's
+// socket are taken for RX first, so with the ports on different sockets
+// each role stays next to its NIC. Lcores left on the remote socket are
+// reported, or refused with --numa-strict.
+int assign_lcore_roles(void) {
+    unsigned lcore_id;
+    unsigned num_workers = rte_lcore_count() - 1;
+    unsigned rx_wanted = 0;
+    unsigned tx_idle = 0;
+    
+    // One TX queue per TX lcore, plus the resolver's
+    struct rte_eth_dev_info tx_info;
+    rte_eth_dev_info_get(tx_port, &tx_info);
+    unsigned tx_max = tx_info.max_tx_queues - (arp_enabled ? 1 : 0);
+    
+    if (dual_port_mode && num_workers >= 2) {
+        struct rte_eth_dev_info dev_info;
+        rte_eth_dev_info_get(rx_port, &dev_info);
+        
+        rx_wanted = rx_queues_requested ? rx_queues_requested : num_workers / 2;
+        rx_wanted = RTE_MIN(rx_wanted, num_workers - 1);
+        rx_wanted = RTE_MIN(rx_wanted, (unsigned)dev_info.max_rx_queues);
+        if (!(dev_info.flow_type_rss_offloads &
+              (RTE_ETH_RSS_IP | RTE_ETH_RSS_UDP | RTE_ETH_RSS_TCP))) {
+            rx_wanted = RTE_MIN(rx_wanted, 1u);
+        }
+        if (rx_wanted == 0) rx_wanted = 1;
+    }
+    
+    // RX lcores are taken from the end of the worker list, local ones first
+    std::vector<unsigned> workers;
+    RTE_LCORE_FOREACH_WORKER(lcore_id) workers.push_back(lcore_id);
+    
+    std::vector<bool> is_rx(RTE_MAX_LCORE, false);
+    int rx_socket = port_socket(rx_port);
+    unsigned rx_picked = 0;
+    for (int pass = 0; pass < 2 && rx_picked < rx_wanted; pass++) {
+        for (auto it = workers.rbegin(); it != workers.rend() && rx_picked < rx_wanted; ++it) {
+            if (is_rx[*it] || (pass == 0 && (int)rte_lcore_to_socket_id(*it) != rx_socket)) continue;
+            is_rx[*it] = true;
+            rx_picked++;
+        }
+    }
+    
+    unsigned remote = 0;
+    for (unsigned lcore_id : workers) {
+        lcore_conf *conf = &lcore_confs[lcore_id];
+        uint16_t port = is_rx[lcore_id] ? rx_port : tx_port;
+        int socket = rte_lcore_to_socket_id(lcore_id);
+        
+        if (socket != port_socket(port)) {
+            printf("WARNING: %s lcore %u is on socket %d, port %u on socket %d\n",
+                   is_rx[lcore_id] ? "RX" : "TX", lcore_id, socket, port, port_socket(port));
+            remote++;
+        }
+        
+        if (is_rx[lcore_id]) {
+            size_t state_size = RTE_ALIGN_CEIL(sizeof(rx_lcore_state), RTE_CACHE_LINE_SIZE);
+            size_t window_size = (size_t)MAX_STREAMS * SEQ_WINDOW_WORDS * sizeof(uint64_t);
+            size_t hist_size = (size_t)MAX_STREAMS * LAT_HIST_BUCKETS * sizeof(uint64_t);
+            size_t mb_size = MICROBURST_RING_SIZE * sizeof(microburst_bucket);
+            uint8_t *mem = (uint8_t*)rte_zmalloc_socket("rx_lcore_state",
+                                                        state_size + window_size + hist_size + mb_size,
+                                                        RTE_CACHE_LINE_SIZE,
+                                                        rte_lcore_to_socket_id(lcore_id));
+            if (!mem) {
+                fprintf(stderr, "Failed to allocate RX state for lcore %u\n", lcore_id);
+                return -1;
+            }
+            
+            conf->rx = (rx_lcore_state*)mem;
+            uint64_t *windows = (uint64_t*)(mem + state_size);
+            uint64_t *hists = (uint64_t*)(mem + state_size + window_size);
+            for (int s = 0; s < MAX_STREAMS; s++) {
+                conf->rx->streams[s].window = windows + (size_t)s * SEQ_WINDOW_WORDS;
+                conf->rx->streams[s].latency_hist = hists + (size_t)s * LAT_HIST_BUCKETS;
+            }
+            conf->rx->mb_ring = (microburst_bucket*)(mem + state_size + window_size + hist_size);
+            
+            if (flow_table_entries > 0 && flow_table_create(lcore_id, conf->rx) != 0) {
+                return -1;
+            }
+            if (flow_sketches_enabled && flow_sketch_create(lcore_id, conf->rx) != 0) {
+                return -1;
+            }
+            
+            conf->role = LCORE_ROLE_RX;
+            conf->queue_id = num_rx_lcores;
+            rx_queue_states[num_rx_lcores++] = conf->rx;
+        } else if (num_tx_lcores >= tx_max) {
+            tx_idle++;
+        } else {
+            conf->tx = (tx_lcore_state*)rte_zmalloc_socket("tx_lcore_state", sizeof(tx_lcore_state),
+                                                           RTE_CACHE_LINE_SIZE,
+                                                           rte_lcore_to_socket_id(lcore_id));
+            if (!conf->tx) {
+                fprintf(stderr, "Failed to allocate TX state for lcore %u\n", lcore_id);
+                return -1;
+            }
+            
+            conf->role = LCORE_ROLE_TX;
+            conf->tx_index = num_tx_lcores;
+            conf->queue_id = num_tx_lcores;
+            num_tx_lcores++;
+        }
+    }
+    
+    if (num_tx_lcores == 0) {
+        fprintf(stderr, "No worker lcores available for TX (use -l with at least 2 cores)\n");
+        return -1;
+    }
+    if (dual_port_mode && num_rx_lcores == 0) {
+        printf("WARNING: Not enough lcores for RX analysis, port %d will not be polled\n", rx_port);
+    }
+    if (tx_idle > 0) {
+        printf("WARNING: Port %d has %u TX queues, %u lcores left idle\n",
+               tx_port, tx_info.max_tx_queues, tx_idle);
+    }
+    
+    if (remote > 0 && numa_strict) {
+        fprintf(stderr, "%u lcores on a remote socket (--numa-strict); pick lcores local to the ports with -l\n",
+                remote);
+        return -1;
+    }
+    
+    printf("Lcores: %u TX, %u RX\n", num_tx_lcores, num_rx_lcores);
+    return 0;
+}
+
+// Sum one profile's TX counters over the TX lcores
+void aggregate_tx_stats(int index, tx_counters *out) {
+    memset(out, 0, sizeof(*out));
+    
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        const tx_lcore_state *state = lcore_confs[lcore_id].tx;
+        if (!state) continue;
+        
+        out->packets_sent += state->profiles[index].packets_sent;
+        out->bytes_sent += state->profiles[index].bytes_sent;
+        out->packets_dropped += state->profiles[index].packets_dropped;
+        out->packets_skipped += state->profiles[index].packets_skipped;
+    }
+}
+
+static inline uint64_t profile_packets_sent(const traffic_profile *prof) {
+    tx_counters cnt;
+    aggregate_tx_stats(prof - profiles, &cnt);
+    return cnt.packets_sent;
+}
+
+// Merge per-queue RX counters
+void aggregate_rx_stats(rx_stats *out) {
+    uint64_t packets = 0, bytes = 0;
+    
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        rx_lcore_state *state = lcore_confs[lcore_id].rx;
+        if (!state) continue;
+        
+        packets += state->packets_received;
+        bytes += state->bytes_received;
+    }
+    
+    memset(out, 0, sizeof(*out));
+    out->packets_received = packets;
+    out->bytes_received = bytes;
+}
+
+// Sum the per-lcore stream counters for one stream. 'hist' (optional,
+// LAT_HIST_BUCKETS entries) receives the merged latency histogram. Jitter
+// is the count-weighted mean of the per-queue estimators.
+void aggregate_stream_stats(uint16_t stream_id, rx_stream_state *out, uint64_t *hist) {
+    unsigned __int128 jitter_weighted = 0;
+    
+    memset(out, 0, sizeof(*out));
+    if (hist) memset(hist, 0, LAT_HIST_BUCKETS * sizeof(uint64_t));
+    
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        rx_lcore_state *state = lcore_confs[lcore_id].rx;
+        if (!state) continue;
+        
+        const rx_stream_state *st = &state->streams[stream_id];
+        if (!st->seen) continue;
+        
+        if (!out->seen || (int32_t)(st->max_seq - out->max_seq) > 0) {
+            out->max_seq = st->max_seq;
+        }
+        out->seen = 1;
+        out->in_order += st->in_order;
+        out->out_of_order += st->out_of_order;
+        out->duplicates += st->duplicates;
+        out->late_arrivals += st->late_arrivals;
+        out->bytes += st->bytes;
+        
+        if (st->latency_count > 0) {
+            if (out->latency_count == 0 || st->latency_min_ns < out->latency_min_ns) {
+                out->latency_min_ns = st->latency_min_ns;
+            }
+            out->latency_max_ns = RTE_MAX(out->latency_max_ns, st->latency_max_ns);
+            out->latency_sum_ns += st->latency_sum_ns;
+            out->latency_count += st->latency_count;
+            out->hw_timestamps += st->hw_timestamps;
+            jitter_weighted += (unsigned __int128)st->jitter_q4 * st->latency_count;
+            
+            if (hist) {
+                for (uint32_t b = 0; b < LAT_HIST_BUCKETS; b++) hist[b] += st->latency_hist[b];
+            }
+        }
+        
+        if (st->ipdv_count > 0) {
+            if (out->ipdv_count == 0 || st->ipdv_min_ns < out->ipdv_min_ns) out->ipdv_min_ns = st->ipdv_min_ns;
+            if (out->ipdv_count == 0 || st->ipdv_max_ns > out->ipdv_max_ns) out->ipdv_max_ns = st->ipdv_max_ns;
+            out->ipdv_abs_sum_ns += st->ipdv_abs_sum_ns;
+            out->ipdv_count += st->ipdv_count;
+        }
+    }
+    
+    if (out->latency_count > 0) out->jitter_q4 = (uint64_t)(jitter_weighted / out->latency_count);
+}
+
+// Latency at a given per-mille quantile of a merged histogram
+uint64_t lat_hist_quantile(const uint64_t *hist, uint64_t count, unsigned per_mille) {
+    if (count == 0) return 0;
+    
+    uint64_t target = (count * per_mille + 999) / 1000;
+    uint64_t cumulative = 0;
+    for (uint32_t b = 0; b < LAT_HIST_BUCKETS; b++) {
+        cumulative += hist[b];
+        if (cumulative >= target) return lat_hist_value(b);
+    }
+    return lat_hist_value(LAT_HIST_BUCKETS - 1);
+}
+
+// Port initialization
+// With more than one RX queue the port is put in RSS mode so the return
+// stream is spread across the RX lcores by IP/UDP/TCP hash.
+int init_port(uint16_t port, struct rte_mempool *mbuf_pool) {
+    const port_plan *pp = &port_plans[port];
+    uint16_t nb_rxq = pp->nb_rxq;
+    uint16_t nb_txq = pp->nb_txq;
+    
+    struct rte_eth_conf port_conf = {};
+    port_conf.rxmode.max_lro_pkt_size = RTE_ETHER_MAX_LEN;
+    port_conf.txmode.offloads = RTE_ETH_TX_OFFLOAD_MULTI_SEGS;
+    
+    struct rte_eth_dev_info dev_info;
+    rte_eth_dev_info_get(port, &dev_info);
+    
+    if (nb_rxq > 1) {
+        uint64_t rss_hf = (RTE_ETH_RSS_IP | RTE_ETH_RSS_UDP | RTE_ETH_RSS_TCP) &
+                          dev_info.flow_type_rss_offloads;
+        if (rss_hf == 0) {
+            printf("WARNING: Port %u does not support RSS, using 1 RX queue\n", port);
+            nb_rxq = 1;
+        } else {
+            port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;
+            port_conf.rx_adv_conf.rss_conf.rss_key = NULL;  // Use default key
+            port_conf.rx_adv_conf.rss_conf.rss_hf = rss_hf;
+        }
+    }
+    
+    // NIC RX timestamps for latency, when the driver supports them
+    bool hw_timestamp = nb_rxq > 0 && port == rx_port &&
+                        (dev_info.rx_offload_capa & RTE_ETH_RX_OFFLOAD_TIMESTAMP);
+    if (hw_timestamp) {
+        if (rte_mbuf_dyn_rx_timestamp_register(&hwts_dynfield_offset, &hwts_dynflag) == 0) {
+            port_conf.rxmode.offloads |= RTE_ETH_RX_OFFLOAD_TIMESTAMP;
+        } else {
+            printf("WARNING: Port %u: cannot register timestamp dynfield, using TSC\n", port);
+            hw_timestamp = false;
+        }
+    }
+    
+    int ret = rte_eth_dev_configure(port, nb_rxq, nb_txq, &port_conf);
+    if (ret != 0) return ret;
+    
+    // Setup RX queues (tx_port only receives control frames)
+    for (uint16_t q = 0; q < nb_rxq; q++) {
+        ret = rte_eth_rx_queue_setup(port, q, pp->nb_rxd,
+                                     rte_eth_dev_socket_id(port),
+                                     NULL, mbuf_pool);
+        if (ret < 0) return ret;
+    }
+    
+    // Setup TX queues
+    struct rte_eth_txconf txconf = dev_info.default_txconf;
+    txconf.offloads = port_conf.txmode.offloads;
+    for (uint16_t q = 0; q < nb_txq; q++) {
+        ret = rte_eth_tx_queue_setup(port, q, pp->nb_txd,
+                                     rte_eth_dev_socket_id(port),
+                                     &txconf);
+        if (ret < 0) return ret;
+    }
+    
+    // CRITICAL: Start the port!
+    ret = rte_eth_dev_start(port);
+    if (ret < 0) {
+        printf("ERROR: Failed to start port %u: %d\n", port, ret);
+        return ret;
+    }
+    printf("✓ Port %u STARTED\n", port);
+    
+    rte_eth_promiscuous_enable(port);
+    
+    if (hw_timestamp) {
+        rte_eth_timesync_enable(port);  // Some PMDs only run the clock with timesync on
+        
+        // Calibrate the NIC clock against the TSC over a short baseline
+        nic_clock_sync clk = {};
+        nic_clock_resync(port, &clk);
+        rte_delay_ms(NIC_CLOCK_RESYNC_MS);
+        nic_clock_resync(port, &clk);
+        
+        if (clk.valid) {
+            nic_clock_nominal = clk;
+            rx_hw_timestamp = true;
+            printf("Port %u: NIC RX timestamps enabled (clock %.3f MHz)\n", port,
+                   1e3 / ((double)clk.ns_per_nic_fp / 4294967296.0));
+        } else {
+            printf("WARNING: Port %u: rte_eth_read_clock unavailable, using TSC\n", port);
+        }
+    }
+    
+    printf("Port %u initialized (%u RX queues x %u, %u TX queues x %u descriptors%s)\n", port,
+           nb_rxq, pp->nb_rxd, nb_txq, pp->nb_txd,
+           port_conf.rxmode.mq_mode == RTE_ETH_MQ_RX_RSS ? ", RSS" : "");
+    
+    return 0;
+}
+
+// Set a profile's inter-packet gap from a frame rate
+void set_profile_rate_fps(traffic_profile *prof, double fps) {
+    uint64_t tsc_hz = rte_get_tsc_hz();
+    
+    prof->inter_packet_gap_ns = (uint64_t)(1e9 / fps);
+    prof->inter_packet_gap_cycles = (uint64_t)(tsc_hz / fps);
+    prof->rate_mbps = fps * prof->packet_size * 8 / 1e6;
+}
+
+// ============================================================================
+// ADDRESS RESOLUTION (ARP)
+// ============================================================================
+// The resolver thread owns RX queue 0 and the last TX queue of tx_port, and
+// TX queue 0 of rx_port. It answers ARP requests for the addresses the
+// profiles emulate (source IPs on tx_port, destination IPs on rx_port),
+// learns next-hop MACs from ARP traffic, and sends the requests that
+// arp_resolve_profiles() queues. ARP, LLDP and CDP frames that reach the
+// RX lcores are handed over through arp_ring.
+
+#define ARP_RX_BURSTS 4                 // RX bursts per wakeup before sleeping again
+#define ARP_POLL_US 200
+#define ARP_RETRY_MS 250
+#define ARP_RETRIES 4
+#define ARP_CACHE_SEC 300               // Resolved next hops are reused this long
+
+enum neighbor_state {
+    NEIGH_INCOMPLETE = 0,
+    NEIGH_REACHABLE = 1,
+    NEIGH_FAILED = 2
+};
+
+struct neighbor_entry {
+    uint8_t state;
+    uint8_t requests;           // Requests sent so far
+    uint16_t port;
+    uint64_t mac;
+    uint32_t src_ip;            // Sender address of our requests
+    uint64_t src_mac;
+    uint64_t updated_tsc;       // Last request sent or reply learned
+};
+
+// Addresses one profile answers for on one port
+struct arp_range {
+    uint16_t port;
+    uint32_t first;
+    uint32_t count;
+    uint64_t mac;
+};
+
+static pthread_mutex_t neighbor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<uint32_t, neighbor_entry> neighbors;    // By IPv4 address (host order)
+static std::vector<arp_range> arp_ranges;
+static uint64_t arp_requests_answered = 0;
+static uint64_t arp_replies_learned = 0;
+
+// ARP frame; dst_mac 0 sends a broadcast request
+static struct rte_mbuf* arp_build(uint16_t port, uint16_t op, uint64_t src_mac, uint32_t src_ip,
+                                  uint64_t dst_mac, uint32_t dst_ip) {
+    struct rte_mbuf *m = rte_pktmbuf_alloc(port_pool(port));
+    if (!m) return NULL;
+    
+    struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, struct rte_ether_hdr*);
+    struct rte_arp_hdr *arp = (struct rte_arp_hdr*)(eth + 1);
+    struct rte_ether_addr tha;
+    
+    mac_from_u64(dst_mac ? dst_mac : 0xFFFFFFFFFFFFULL, &eth->dst_addr);
+    mac_from_u64(src_mac, &eth->src_addr);
+    eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP);
+    
+    arp->arp_hardware = rte_cpu_to_be_16(RTE_ARP_HRD_ETHER);
+    arp->arp_protocol = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+    arp->arp_hlen = RTE_ETHER_ADDR_LEN;
+    arp->arp_plen = sizeof(uint32_t);
+    arp->arp_opcode = rte_cpu_to_be_16(op);
+    memcpy(arp->arp_data.arp_sha.addr_bytes, eth->src_addr.addr_bytes, RTE_ETHER_ADDR_LEN);
+    arp->arp_data.arp_sip = rte_cpu_to_be_32(src_ip);
+    mac_from_u64(dst_mac, &tha);
+    memcpy(arp->arp_data.arp_tha.addr_bytes, tha.addr_bytes, RTE_ETHER_ADDR_LEN);
+    arp->arp_data.arp_tip = rte_cpu_to_be_32(dst_ip);
+    
+    // Pad to the minimum frame size (CRC added by the NIC)
+    m->data_len = RTE_ETHER_MIN_LEN - RTE_ETHER_CRC_LEN;
+    m->pkt_len = m->data_len;
+    memset((uint8_t*)(arp + 1), 0, m->data_len - sizeof(*eth) - sizeof(*arp));
+    return m;
+}
+
+// Returns false (and frees the frame) when the TX queue was full
+static bool arp_send(uint16_t port, struct rte_mbuf *m) {
+    uint16_t queue = port == tx_port ? arp_tx_queue : 0;
+    if (rte_eth_tx_burst(port, queue, &m, 1) == 0) {
+        rte_pktmbuf_free(m);
+        return false;
+    }
+    return true;
+}
+
+// One received ARP frame: learn the sender, answer requests for our addresses
+static void arp_input(uint16_t port, struct rte_mbuf *m) {
+    if (rte_pktmbuf_data_len(m) < sizeof(struct rte_ether_hdr) + sizeof(struct rte_arp_hdr)) return;
+    
+    const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, const struct rte_ether_hdr*);
+    const struct rte_arp_hdr *arp = (const struct rte_arp_hdr*)(eth + 1);
+    if (eth->ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP) ||
+        arp->arp_hardware != rte_cpu_to_be_16(RTE_ARP_HRD_ETHER) ||
+        arp->arp_protocol != rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) {
+        return;
+    }
+    
+    uint32_t sip = rte_be_to_cpu_32(arp->arp_data.arp_sip);
+    uint32_t tip = rte_be_to_cpu_32(arp->arp_data.arp_tip);
+    uint64_t sha = mac_to_u64(arp->arp_data.arp_sha.addr_bytes);
+    struct rte_mbuf *reply = NULL;
+    
+    pthread_mutex_lock(&neighbor_mutex);
+    
+    // RFC 826 merge: refresh the sender if it is a next hop we track
+    auto it = neighbors.find(sip);
+    if (it != neighbors.end() && it->second.port == port) {
+        it->second.mac = sha;
+        it->second.state = NEIGH_REACHABLE;
+        it->second.updated_tsc = rte_get_tsc_cycles();
+        arp_replies_learned++;
+    }
+    
+    if (arp->arp_opcode == rte_cpu_to_be_16(RTE_ARP_OP_REQUEST)) {
+        for (const arp_range &r : arp_ranges) {
+            if (r.port == port && tip - r.first < r.count) {
+                reply = arp_build(port, RTE_ARP_OP_REPLY, r.mac, tip, sha, sip);
+                arp_requests_answered++;
+                break;
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&neighbor_mutex);
+    
+    if (reply) arp_send(port, reply);
+}
+
+// Send due requests for unresolved next hops; give up after ARP_RETRIES
+static void arp_send_requests(uint64_t now) {
+    uint64_t retry_cycles = rte_get_tsc_hz() / 1000 * ARP_RETRY_MS;
+    std::vector<std::pair<uint16_t, struct rte_mbuf*>> out;
+    
+    pthread_mutex_lock(&neighbor_mutex);
+    for (auto &kv : neighbors) {
+        neighbor_entry &n = kv.second;
+        if (n.state != NEIGH_INCOMPLETE || (n.requests > 0 && now - n.updated_tsc < retry_cycles)) continue;
+        
+        if (n.requests == ARP_RETRIES) {
+            n.state = NEIGH_FAILED;
+            continue;
+        }
+        struct rte_mbuf *m = arp_build(n.port, RTE_ARP_OP_REQUEST, n.src_mac, n.src_ip, 0, kv.first);
+        if (m) out.push_back({n.port, m});
+        n.requests++;
+        n.updated_tsc = now;
+    }
+    pthread_mutex_unlock(&neighbor_mutex);
+    
+    for (auto &o : out) arp_send(o.first, o.second);
+}
+
+// Publish the addresses to answer for and queue a request for the next hop
+// of every profile with resolve_mac set (gateway_ip, else dst_ip). Fresh
+// cache entries are reused without a request. Never blocks: the resolver
+// thread sends the requests. Returns true while a next hop is unresolved.
+static bool arp_queue_profiles(void) {
+    uint64_t now = rte_get_tsc_cycles();
+    uint64_t cache_cycles = rte_get_tsc_hz() * ARP_CACHE_SEC;
+    bool pending = false;
+    
+    std::vector<arp_range> ranges;
+    struct rte_ether_addr rx_mac = {};
+    if (dual_port_mode) rte_eth_macaddr_get(rx_port, &rx_mac);
+    
+    for (int i = 0; i < num_profiles; i++) {
+        const traffic_profile *prof = &profiles[i];
+        ranges.push_back({(uint16_t)tx_port, prof->src_ip, RTE_MAX(prof->src_ip_count, 1u), prof->src_mac});
+        if (dual_port_mode) {
+            ranges.push_back({(uint16_t)rx_port, prof->dst_ip, 1, mac_to_u64(rx_mac.addr_bytes)});
+        }
+    }
+    
+    pthread_mutex_lock(&neighbor_mutex);
+    arp_ranges.swap(ranges);
+    
+    for (int i = 0; i < num_profiles; i++) {
+        const traffic_profile *prof = &profiles[i];
+        if (!prof->resolve_mac) continue;
+        
+        uint32_t next_hop = prof->gateway_ip ? prof->gateway_ip : prof->dst_ip;
+        neighbor_entry &n = neighbors[next_hop];
+        if (n.state == NEIGH_REACHABLE && now - n.updated_tsc < cache_cycles) continue;
+        if (n.state == NEIGH_INCOMPLETE && n.requests > 0) {
+            pending = true;
+            continue;
+        }
+        
+        n.state = NEIGH_INCOMPLETE;
+        n.requests = 0;
+        n.port = tx_port;
+        n.src_ip = prof->src_ip;
+        n.src_mac = prof->src_mac;
+        pending = true;
+    }
+    pthread_mutex_unlock(&neighbor_mutex);
+    
+    return pending;
+}
+
+// Copy the cached MAC of each resolve_mac profile's next hop into its
+// dst_mac. Never blocks. Sets *pending while a request is outstanding.
+// Returns an error message for a next hop that failed, or NULL.
+static const char* arp_apply_profiles(bool *pending) {
+    static char error[128];
+    const char *err = NULL;
+    
+    *pending = false;
+    pthread_mutex_lock(&neighbor_mutex);
+    for (int i = 0; i < num_profiles; i++) {
+        traffic_profile *prof = &profiles[i];
+        if (!prof->resolve_mac) continue;
+        
+        uint32_t next_hop = prof->gateway_ip ? prof->gateway_ip : prof->dst_ip;
+        auto it = neighbors.find(next_hop);
+        if (it != neighbors.end() && it->second.state == NEIGH_REACHABLE) {
+            prof->dst_mac = it->second.mac;
+        } else if (it != neighbors.end() && it->second.state == NEIGH_INCOMPLETE) {
+            *pending = true;
+        } else if (!err) {
+            snprintf(error, sizeof(error), "ARP resolution failed for %u.%u.%u.%u",
+                     next_hop >> 24, (next_hop >> 16) & 0xFF, (next_hop >> 8) & 0xFF, next_hop & 0xFF);
+            err = error;
+        }
+    }
+    pthread_mutex_unlock(&neighbor_mutex);
+    
+    return err;
+}
+
+// Resolve the profiles' next hops, waiting for the resolver thread. For the
+// test threads; the control thread polls arp_apply_profiles() instead.
+// Returns an error message or NULL.
+const char* arp_resolve_profiles(void) {
+    bool pending = arp_queue_profiles();
+    if (pending && !arp_ring) {
+        return "ARP resolver disabled (--no-arp)";
+    }
+    
+    // The resolver gives up after ARP_RETRIES * ARP_RETRY_MS
+    const char *err = arp_apply_profiles(&pending);
+    for (int waited = 0; pending && waited < (ARP_RETRIES + 1) * ARP_RETRY_MS; waited += 10) {
+        usleep(10000);
+        err = arp_apply_profiles(&pending);
+    }
+    return pending ? "ARP resolution timed out" : err;
+}
+
+// Neighbor table and responder counters as JSON
+void arp_format_json(std::string &out) {
+    static const char *state_names[] = {"incomplete", "reachable", "failed"};
+    char buf[256];
+    
+    pthread_mutex_lock(&neighbor_mutex);
+    snprintf(buf, sizeof(buf),
+             "{\"status\":\"success\",\"enabled\":%s,\"requests_answered\":%lu,"
+             "\"replies_learned\":%lu,\"emulated_ranges\":%zu,\"neighbors\":[",
+             arp_ring ? "true" : "false", arp_requests_answered, arp_replies_learned,
+             arp_ranges.size());
+    out += buf;
+    
+    bool first = true;
+    uint64_t now = rte_get_tsc_cycles();
+    for (const auto &kv : neighbors) {
+        const neighbor_entry &n = kv.second;
+        uint32_t ip = kv.first;
+        snprintf(buf, sizeof(buf),
+                 "%s{\"ip\":\"%u.%u.%u.%u\",\"port\":%u,\"state\":\"%s\","
+                 "\"mac\":\"%02lx:%02lx:%02lx:%02lx:%02lx:%02lx\",\"age_ms\":%lu}",
+                 first ? "" : ",", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF,
+                 n.port, state_names[n.state],
+                 (n.mac >> 40) & 0xFF, (n.mac >> 32) & 0xFF, (n.mac >> 24) & 0xFF,
+                 (n.mac >> 16) & 0xFF, (n.mac >> 8) & 0xFF, n.mac & 0xFF,
+                 (now - n.updated_tsc) * 1000 / rte_get_tsc_hz());
+        out += buf;
+        first = false;
+    }
+    pthread_mutex_unlock(&neighbor_mutex);
+    
+    out += "]}\n";
+}
+
+// ============================================================================
+// DEVICE DISCOVERY
+// ============================================================================
+// The discovered-device table and subnet sweep live in dpdk_link_discovery.c.
+// The resolver thread feeds it every ARP frame it handles, sends the sweep's
+// probes on its own TX queue and expires idle devices.
+
+#define DISCOVERY_CLEANUP_SEC 10
+#define DISCOVERY_JSON_SIZE (1u << 20)
+
+// "offset" and "limit" of a discovery listing request; a listing that does
+// not fit DISCOVERY_JSON_SIZE comes back with "truncated":true and is
+// continued with offset += count
+static void discovery_page(struct json_object *root, uint32_t *offset, uint32_t *limit) {
+    struct json_object *val;
+    *offset = 0;
+    *limit = UINT32_MAX;
+    if (json_object_object_get_ex(root, "offset", &val)) {
+        *offset = RTE_MIN(RTE_MAX(json_object_get_int64(val), (int64_t)0), (int64_t)UINT32_MAX);
+    }
+    if (json_object_object_get_ex(root, "limit", &val) && json_object_get_int64(val) > 0) {
+        *limit = RTE_MIN(json_object_get_int64(val), (int64_t)UINT32_MAX);
+    }
+}
+
+// Arm an ARP sweep of "subnet" (a.b.c.d/len) on tx_port at "rate_pps".
+// Returns an error message or NULL.
+const char* discovery_scan_start(struct json_object *root) {
+    struct json_object *val;
+    char subnet[32];
+    uint32_t rate_pps = 0;
+    
+    if (!arp_ring) return "Discovery needs the ARP resolver (--no-arp)";
+    if (!json_object_object_get_ex(root, "subnet", &val)) return "No subnet specified";
+    snprintf(subnet, sizeof(subnet), "%s", json_object_get_string(val));
+    if (json_object_object_get_ex(root, "rate_pps", &val)) {
+        rate_pps = RTE_MIN(RTE_MAX(json_object_get_int64(val), (int64_t)0), (int64_t)UINT32_MAX);
+    }
+    
+    char *slash = strchr(subnet, '/');
+    int prefix = 32;
+    if (slash) {
+        *slash = '\0';
+        prefix = atoi(slash + 1);
+    }
+    struct in_addr addr;
+    if (inet_pton(AF_INET, subnet, &addr) != 1 || prefix < 0 || prefix > 32) return "Invalid subnet";
+    
+    if (dpdk_scan_subnet_start(tx_port, arp_tx_queue, port_pool(tx_port), addr.s_addr,
+                               (uint8_t)prefix, rate_pps) != 0) {
+        return "Scan already running or prefix shorter than /8";
+    }
+    return NULL;
+}
+
+// ============================================================================
+// LLDP / CDP TOPOLOGY
+// ============================================================================
+// Neighbors announce themselves with LLDP (802.1AB) or CDP. Frames are
+// recognised by their Ethernet type (or the CDP multicast address) only
+// after the test-signature check failed, so test traffic pays nothing. RX
+// lcores hand them to the resolver thread over arp_ring, which parses them
+// together with those on tx_port and sends our own LLDPDUs every
+// --lldp-interval seconds.
+
+#define LLDP_MULTICAST 0x0180C200000EULL    // Nearest bridge
+#define LLDP_MAX_NEIGHBORS 256
+
+enum lldp_tlv_type {
+    LLDP_TLV_END = 0,
+    LLDP_TLV_CHASSIS_ID = 1,
+    LLDP_TLV_PORT_ID = 2,
+    LLDP_TLV_TTL = 3,
+    LLDP_TLV_PORT_DESC = 4,
+    LLDP_TLV_SYSTEM_NAME = 5,
+    LLDP_TLV_SYSTEM_DESC = 6,
+    LLDP_TLV_CAPABILITIES = 7,
+    LLDP_TLV_MGMT_ADDR = 8
+};
+
+struct topology_neighbor {
+    struct discovered_device dev;
+    uint16_t local_port;
+    bool cdp;
+    uint64_t expires_tsc;
+};
+
+static pthread_mutex_t topology_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, topology_neighbor> topology;   // "port/chassis/port id"
+static uint64_t lldp_frames_sent = 0;
+static uint64_t lldp_frames_received = 0;
+
+// Copy a TLV string, keeping printable ASCII only
+static void lldp_copy_string(char *dst, size_t size, const uint8_t *src, size_t len) {
+    size_t n = RTE_MIN(len, size - 1);
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (src[i] >= 0x20 && src[i] < 0x7F) ? (char)src[i] : '.';
+    }
+    dst[n] = '\0';
+}
+
+// Chassis and port IDs: MAC subtypes as text, everything else as a string
+static void lldp_copy_id(char *dst, size_t size, const uint8_t *val, size_t len, uint8_t mac_subtype) {
+    if (len == 1 + RTE_ETHER_ADDR_LEN && val[0] == mac_subtype) {
+        snprintf(dst, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+                 val[1], val[2], val[3], val[4], val[5], val[6]);
+    } else if (len > 1) {
+        lldp_copy_string(dst, size, val + 1, len - 1);
+    }
+}
+
+// Parse an LLDPDU into 'device'. Returns 0, or -1 if the frame is not a
+// valid LLDPDU (the three mandatory TLVs missing)
+int parse_lldp_packet(struct rte_mbuf *mbuf, struct discovered_device *device) {
+    const uint8_t *data = rte_pktmbuf_mtod(mbuf, const uint8_t*);
+    uint16_t len = rte_pktmbuf_data_len(mbuf);
+    uint16_t off = sizeof(struct rte_ether_hdr);
+    unsigned mandatory = 0;
+    
+    memset(device, 0, sizeof(*device));
+    
+    while (off + 2 <= len) {
+        uint16_t hdr = (data[off] << 8) | data[off + 1];
+        uint8_t type = hdr >> 9;
+        uint16_t tlv_len = hdr & 0x1FF;
+        const uint8_t *val = data + off + 2;
+        off += 2;
+        
+        if (type == LLDP_TLV_END) break;
+        if (off + tlv_len > len) return -1;
+        off += tlv_len;
+        
+        switch (type) {
+            case LLDP_TLV_CHASSIS_ID:
+                if (tlv_len == 1 + RTE_ETHER_ADDR_LEN && val[0] == 4) {
+                    memcpy(device->mac_addr, val + 1, RTE_ETHER_ADDR_LEN);
+                }
+                lldp_copy_id(device->chassis_id, sizeof(device->chassis_id), val, tlv_len, 4);
+                mandatory |= 1;
+                break;
+            case LLDP_TLV_PORT_ID:
+                lldp_copy_id(device->port_id, sizeof(device->port_id), val, tlv_len, 3);
+                mandatory |= 2;
+                break;
+            case LLDP_TLV_TTL:
+                if (tlv_len >= 2) device->ttl = (val[0] << 8) | val[1];
+                mandatory |= 4;
+                break;
+            case LLDP_TLV_PORT_DESC:
+                lldp_copy_string(device->port_description, sizeof(device->port_description), val, tlv_len);
+                break;
+            case LLDP_TLV_SYSTEM_NAME:
+                lldp_copy_string(device->system_name, sizeof(device->system_name), val, tlv_len);
+                break;
+            case LLDP_TLV_SYSTEM_DESC:
+                lldp_copy_string(device->system_description, sizeof(device->system_description), val, tlv_len);
+                break;
+            case LLDP_TLV_CAPABILITIES:
+                if (tlv_len >= 4) {
+                    device->capabilities = (val[0] << 8) | val[1];
+                    device->enabled_capabilities = (val[2] << 8) | val[3];
+                }
+                break;
+            case LLDP_TLV_MGMT_ADDR:
+                // Address string length, subtype (1 = IPv4), address
+                if (tlv_len >= 6 && val[0] == 5 && val[1] == 1 && device->ip_addr == 0) {
+                    device->ip_addr = ((uint32_t)val[2] << 24) | (val[3] << 16) | (val[4] << 8) | val[5];
+                }
+                break;
+        }
+    }
+    
+    return mandatory == 7 ? 0 : -1;
+}
+
+// Parse a CDP frame (802.3 + SNAP) into 'device'. Returns 0 or -1.
+static int parse_cdp_packet(struct rte_mbuf *mbuf, struct discovered_device *device) {
+    static const uint8_t cdp_snap[] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x0C, 0x20, 0x00};
+    const uint8_t *data = rte_pktmbuf_mtod(mbuf, const uint8_t*);
+    uint16_t len = rte_pktmbuf_data_len(mbuf);
+    uint16_t off = sizeof(struct rte_ether_hdr);
+    
+    if (len < off + sizeof(cdp_snap) + 4 || memcmp(data + off, cdp_snap, sizeof(cdp_snap)) != 0) {
+        return -1;
+    }
+    off += sizeof(cdp_snap);
+    
+    memset(device, 0, sizeof(*device));
+    device->ttl = data[off + 1];
+    off += 4;       // Version, holdtime, checksum
+    
+    while (off + 4 <= len) {
+        uint16_t type = (data[off] << 8) | data[off + 1];
+        uint16_t tlv_len = (data[off + 2] << 8) | data[off + 3];
+        const uint8_t *val = data + off + 4;
+        if (tlv_len < 4 || off + tlv_len > len) break;
+        off += tlv_len;
+        tlv_len -= 4;
+        
+        switch (type) {
+            case 0x0001:    // Device ID
+                lldp_copy_string(device->chassis_id, sizeof(device->chassis_id), val, tlv_len);
+                lldp_copy_string(device->system_name, sizeof(device->system_name), val, tlv_len);
+                break;
+            case 0x0002:    // Addresses: count, then protocol type/len/protocol/len/address
+                if (tlv_len >= 13 && val[4] == 1 && val[5] == 1 && val[6] == 0xCC && val[8] == 4) {
+                    device->ip_addr = ((uint32_t)val[9] << 24) | (val[10] << 16) | (val[11] << 8) | val[12];
+                }
+                break;
+            case 0x0003:    // Port ID
+                lldp_copy_string(device->port_id, sizeof(device->port_id), val, tlv_len);
+                break;
+            case 0x0004:    // Capabilities (32 bits, low 16 used)
+                if (tlv_len >= 4) device->capabilities = (val[2] << 8) | val[3];
+                break;
+            case 0x0005:    // Software version
+                lldp_copy_string(device->system_description, sizeof(device->system_description), val, tlv_len);
+                break;
+            case 0x0006:    // Platform
+                lldp_copy_string(device->vendor, sizeof(device->vendor), val, tlv_len);
+                break;
+        }
+    }
+    
+    memcpy(device->mac_addr, ((const struct rte_ether_hdr*)data)->src_addr.addr_bytes, RTE_ETHER_ADDR_LEN);
+    return device->chassis_id[0] ? 0 : -1;
+}
+
+// LLDP or CDP frame received on 'port' (resolver thread only)
+static void topology_input(uint16_t port, struct rte_mbuf *m, bool cdp) {
+    topology_neighbor n = {};
+    if ((cdp ? parse_cdp_packet(m, &n.dev) : parse_lldp_packet(m, &n.dev)) != 0) return;
+    
+    n.local_port = port;
+    n.cdp = cdp;
+    n.dev.port_number = port;
+    n.dev.last_seen = time(NULL);
+    n.expires_tsc = rte_get_tsc_cycles() + rte_get_tsc_hz() * n.dev.ttl;
+    
+    std::string key = std::to_string(port) + "/" + n.dev.chassis_id + "/" + n.dev.port_id;
+    
+    pthread_mutex_lock(&topology_mutex);
+    lldp_frames_received++;
+    if (n.dev.ttl == 0) {
+        topology.erase(key);        // Shutdown LLDPDU
+    } else if (topology.size() < LLDP_MAX_NEIGHBORS || topology.count(key)) {
+        topology[key] = n;
+    }
+    pthread_mutex_unlock(&topology_mutex);
+}
+
+static void lldp_put_tlv(uint8_t **p, uint8_t type, const void *val, uint16_t len) {
+    (*p)[0] = (type << 1) | (len >> 8);
+    (*p)[1] = len & 0xFF;
+    memcpy(*p + 2, val, len);
+    *p += 2 + len;
+}
+
+// Send one LLDPDU on 'port' (resolver thread only: it owns the TX queue)
+int send_lldp_packet(uint16_t port_id) {
+    struct rte_mbuf *m = rte_pktmbuf_alloc(port_pool(port_id));
+    if (!m) return -1;
+    
+    struct rte_ether_addr port_mac;
+    rte_eth_macaddr_get(port_id, &port_mac);
+    
+    uint8_t *data = rte_pktmbuf_mtod(m, uint8_t*);
+    struct rte_ether_hdr *eth = (struct rte_ether_hdr*)data;
+    mac_from_u64(LLDP_MULTICAST, &eth->dst_addr);
+    rte_ether_addr_copy(&port_mac, &eth->src_addr);
+    eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_LLDP);
+    uint8_t *p = data + sizeof(*eth);
+    
+    // Chassis: MAC of tx_port; port: this port's MAC
+    struct rte_ether_addr chassis_mac;
+    rte_eth_macaddr_get(tx_port, &chassis_mac);
+    uint8_t id[1 + RTE_ETHER_ADDR_LEN];
+    id[0] = 4;
+    memcpy(id + 1, chassis_mac.addr_bytes, RTE_ETHER_ADDR_LEN);
+    lldp_put_tlv(&p, LLDP_TLV_CHASSIS_ID, id, sizeof(id));
+    id[0] = 3;
+    memcpy(id + 1, port_mac.addr_bytes, RTE_ETHER_ADDR_LEN);
+    lldp_put_tlv(&p, LLDP_TLV_PORT_ID, id, sizeof(id));
+    
+    uint16_t ttl = rte_cpu_to_be_16(RTE_MIN(lldp_interval_sec * 4u, 65535u));
+    lldp_put_tlv(&p, LLDP_TLV_TTL, &ttl, sizeof(ttl));
+    
+    char text[128];
+    snprintf(text, sizeof(text), "NetGen Pro port %u (%s)", port_id, port_id == tx_port ? "TX" : "RX");
+    lldp_put_tlv(&p, LLDP_TLV_PORT_DESC, text, strlen(text));
+    if (gethostname(text, sizeof(text)) != 0) snprintf(text, sizeof(text), "netgen");
+    text[sizeof(text) - 1] = '\0';
+    lldp_put_tlv(&p, LLDP_TLV_SYSTEM_NAME, text, strlen(text));
+    snprintf(text, sizeof(text), "NetGen Pro DPDK traffic generator");
+    lldp_put_tlv(&p, LLDP_TLV_SYSTEM_DESC, text, strlen(text));
+    
+    uint8_t caps[4] = {0x00, 0x80, 0x00, 0x80};     // Station only
+    lldp_put_tlv(&p, LLDP_TLV_CAPABILITIES, caps, sizeof(caps));
+    lldp_put_tlv(&p, LLDP_TLV_END, NULL, 0);
+    
+    m->data_len = RTE_MAX((uint16_t)(p - data), (uint16_t)(RTE_ETHER_MIN_LEN - RTE_ETHER_CRC_LEN));
+    m->pkt_len = m->data_len;
+    memset(p, 0, m->data_len - (p - data));
+    
+    if (!arp_send(port_id, m)) return -1;
+    lldp_frames_sent++;
+    return 0;
+}
+
+// Current neighbors of 'port_id' (expired ones are dropped). Returns the count.
+int discover_network_topology(uint16_t port_id, struct topology_info *topo) {
+    uint64_t now = rte_get_tsc_cycles();
+    memset(topo, 0, sizeof(*topo));
+    
+    pthread_mutex_lock(&topology_mutex);
+    for (auto it = topology.begin(); it != topology.end();) {
+        if (now > it->second.expires_tsc) {
+            it = topology.erase(it);
+            continue;
+        }
+        if (it->second.local_port == port_id && topo->num_devices < RTE_DIM(topo->devices)) {
+            topo->devices[topo->num_devices++] = it->second.dev;
+        }
+        ++it;
+    }
+    pthread_mutex_unlock(&topology_mutex);
+    
+    topo->last_discovery_time = time(NULL);
+    return topo->num_devices;
+}
+
+static void json_append_string(std::string &out, const char *s) {
+    out += '"';
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') out += '\\';
+        out += *s;
+    }
+    out += '"';
+}
+
+// Neighbors of both ports as JSON
+void topology_format_json(std::string &out) {
+    static topology_info topo;      // Control thread only
+    char buf[256];
+    
+    snprintf(buf, sizeof(buf), "{\"status\":\"success\",\"lldp_interval_sec\":%u,"
+             "\"lldp_sent\":%lu,\"lldp_received\":%lu,\"ports\":[",
+             lldp_interval_sec, lldp_frames_sent, lldp_frames_received);
+    out += buf;
+    
+    int ports[2] = {tx_port, rx_port};
+    int nb_ports = dual_port_mode ? 2 : 1;
+    for (int pi = 0; pi < nb_ports; pi++) {
+        discover_network_topology(ports[pi], &topo);
+        snprintf(buf, sizeof(buf), "%s{\"port\":%d,\"neighbors\":[", pi ? "," : "", ports[pi]);
+        out += buf;
+        
+        for (uint16_t i = 0; i < topo.num_devices; i++) {
+            const discovered_device *d = &topo.devices[i];
+            out += i ? ",{\"chassis_id\":" : "{\"chassis_id\":";
+            json_append_string(out, d->chassis_id);
+            out += ",\"port_id\":";
+            json_append_string(out, d->port_id);
+            out += ",\"port_description\":";
+            json_append_string(out, d->port_description);
+            out += ",\"system_name\":";
+            json_append_string(out, d->system_name);
+            out += ",\"system_description\":";
+            json_append_string(out, d->system_description);
+            out += ",\"platform\":";
+            json_append_string(out, d->vendor);
+            uint32_t ip = d->ip_addr;
+            snprintf(buf, sizeof(buf),
+                     ",\"mgmt_ip\":\"%u.%u.%u.%u\",\"capabilities\":%u,\"enabled_capabilities\":%u,"
+                     "\"ttl\":%u,\"last_seen\":%u}",
+                     ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF,
+                     d->capabilities, d->enabled_capabilities, d->ttl, d->last_seen);
+            out += buf;
+        }
+        out += "]}";
+    }
+    out += "]}\n";
+}
+
+// ============================================================================
+// MULTI-PROCESS
+// ============================================================================
+// Helper tools attach as DPDK secondaries (layout: netgen_mp.h) instead of
+// taking the ports over. Each port gets an inject ring, drained by the
+// resolver thread onto the TX queue it already owns, and a capture ring fed
+// with the frames that carry no test signature: everything on tx_port (the
+// resolver owns its only RX queue) and the unsigned frames of the RX lcores
+// on rx_port. Capture costs nothing until a consumer attaches.
+
+#define MP_REAP_SEC 1                   // Dead capture consumers are noticed this fast
+
+struct mp_port_rings {
+    struct rte_ring *inject;
+    struct rte_ring *capture;
+};
+
+static const struct rte_memzone *mp_zone = NULL;
+static struct netgen_mp_info *mp_info = NULL;
+static mp_port_rings mp_rings[NETGEN_MP_MAX_PORTS];
+
+static inline int mp_port_index(uint16_t port) {
+    return port == tx_port ? 0 : 1;
+}
+
+static inline void mp_capture(uint16_t port, struct rte_mbuf *m) {
+    if (likely(mp_info == NULL)) return;
+    int idx = mp_port_index(port);
+    struct netgen_mp_port *p = &mp_info->ports[idx];
+    if (likely(__atomic_load_n(&p->capture_consumers, __ATOMIC_RELAXED) == 0)) return;
+    
+    // The consumer frees its reference
+    rte_mbuf_refcnt_update(m, 1);
+    if (rte_ring_mp_enqueue(mp_rings[idx].capture, m) != 0) {
+        rte_mbuf_refcnt_update(m, -1);
+        __atomic_fetch_add(&p->capture_dropped, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&p->captured, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Send what the secondaries injected (resolver thread)
+static void mp_inject_drain(void) {
+    struct rte_mbuf *bufs[BURST_SIZE];
+    
+    for (uint32_t i = 0; i < mp_info->num_ports; i++) {
+        struct netgen_mp_port *p = &mp_info->ports[i];
+        unsigned nb = rte_ring_sc_dequeue_burst(mp_rings[i].inject, (void**)bufs, BURST_SIZE, NULL);
+        if (nb == 0) continue;
+        
+        uint16_t queue = p->port_id == tx_port ? arp_tx_queue : 0;
+        uint16_t sent = rte_eth_tx_burst(p->port_id, queue, bufs, nb);
+        if (sent < nb) {
+            rte_pktmbuf_free_bulk(&bufs[sent], nb - sent);
+        }
+        __atomic_fetch_add(&p->injected, sent, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&p->inject_dropped, nb - sent, __ATOMIC_RELAXED);
+    }
+}
+
+// Release the capture slots of consumers that exited without detaching and
+// empty the capture rings nobody reads any more (resolver thread)
+static void mp_reap_consumers(void) {
+    struct rte_mbuf *bufs[BURST_SIZE];
+    
+    for (uint32_t i = 0; i < mp_info->num_ports; i++) {
+        struct netgen_mp_port *p = &mp_info->ports[i];
+        for (int c = 0; c < NETGEN_MP_MAX_CONSUMERS; c++) {
+            int32_t pid = __atomic_load_n(&p->consumer_pids[c], __ATOMIC_ACQUIRE);
+            if (pid == 0 || kill(pid, 0) == 0 || errno != ESRCH) continue;
+            if (__atomic_compare_exchange_n(&p->consumer_pids[c], &pid, 0, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                __atomic_fetch_sub(&p->capture_consumers, 1, __ATOMIC_RELAXED);
+                printf("Capture consumer %d on port %u exited without detaching\n", pid, p->port_id);
+            }
+        }
+        
+        if (__atomic_load_n(&p->capture_consumers, __ATOMIC_RELAXED) > 0) continue;
+        unsigned nb;
+        while ((nb = rte_ring_mc_dequeue_burst(mp_rings[i].capture, (void**)bufs, BURST_SIZE, NULL)) > 0) {
+            rte_pktmbuf_free_bulk(bufs, nb);
+        }
+    }
+}
+
+// Publish the pool, the rings and the stats region for secondaries. Needs
+// the resolver thread, which drains the inject rings.
+static int mp_init(const char *control_socket) {
+    mp_zone = rte_memzone_reserve_aligned(NETGEN_MP_INFO_NAME, sizeof(netgen_mp_info),
+                                          rte_socket_id(), 0, RTE_CACHE_LINE_SIZE);
+    if (!mp_zone) {
+        fprintf(stderr, "Failed to reserve memzone %s (another primary running?)\n",
+                NETGEN_MP_INFO_NAME);
+        return -1;
+    }
+    netgen_mp_info *info = (netgen_mp_info*)mp_zone->addr;
+    memset(info, 0, sizeof(*info));
+    info->magic = NETGEN_MP_MAGIC;
+    info->version = NETGEN_MP_VERSION;
+    info->primary_pid = getpid();
+    snprintf(info->stats_shm_name, sizeof(info->stats_shm_name), "%s",
+             stats_publish_hz > 0 ? NETGEN_STATS_SHM_NAME : "");
+    snprintf(info->control_socket, sizeof(info->control_socket), "%s", control_socket);
+    
+    int ports[NETGEN_MP_MAX_PORTS] = {tx_port, rx_port};
+    info->num_ports = dual_port_mode ? 2 : 1;
+    for (uint32_t i = 0; i < info->num_ports; i++) {
+        struct netgen_mp_port *p = &info->ports[i];
+        p->port_id = ports[i];
+        p->role = i == 0 ? NETGEN_MP_PORT_TX : NETGEN_MP_PORT_RX;
+        snprintf(p->pool_name, sizeof(p->pool_name), "%s", port_pool(p->port_id)->name);
+        snprintf(p->inject_ring, sizeof(p->inject_ring), "netgen_inject_%u", p->port_id);
+        snprintf(p->capture_ring, sizeof(p->capture_ring), "netgen_capture_%u", p->port_id);
+        
+        mp_rings[i].inject = rte_ring_create(p->inject_ring, NETGEN_MP_RING_SIZE,
+                                             rte_eth_dev_socket_id(p->port_id), RING_F_SC_DEQ);
+        mp_rings[i].capture = rte_ring_create(p->capture_ring, NETGEN_MP_RING_SIZE,
+                                              rte_eth_dev_socket_id(p->port_id), 0);
+        if (!mp_rings[i].inject || !mp_rings[i].capture) {
+            fprintf(stderr, "Failed to create multi-process rings for port %u\n", p->port_id);
+            return -1;
+        }
+    }
+    
+    // Published last: the RX lcores test mp_info before touching the rings
+    rte_smp_wmb();
+    mp_info = info;
+    printf("Secondary processes attach through memzone %s\n", NETGEN_MP_INFO_NAME);
+    return 0;
+}
+
+static void mp_free(void) {
+    if (mp_info) {
+        for (uint32_t i = 0; i < mp_info->num_ports; i++) {
+            mp_info->ports[i].capture_consumers = 0;
+        }
+    }
+    mp_info = NULL;
+    for (int i = 0; i < NETGEN_MP_MAX_PORTS; i++) {
+        rte_ring_free(mp_rings[i].inject);
+        rte_ring_free(mp_rings[i].capture);
+        mp_rings[i].inject = mp_rings[i].capture = NULL;
+    }
+    if (mp_zone) {
+        rte_memzone_free(mp_zone);
+        mp_zone = NULL;
+    }
+}
+
+// Attachment state and ring counters as JSON
+void mp_format_json(char *buf, size_t size) {
+    if (!mp_info) {
+        snprintf(buf, size, "{\"status\":\"success\",\"enabled\":false}\n");
+        return;
+    }
+    int len = snprintf(buf, size, "{\"status\":\"success\",\"enabled\":true,\"memzone\":\"%s\",\"ports\":[",
+                       NETGEN_MP_INFO_NAME);
+    for (uint32_t i = 0; i < mp_info->num_ports && len < (int)size; i++) {
+        const struct netgen_mp_port *p = &mp_info->ports[i];
+        len += snprintf(buf + len, size - len,
+                        "%s{\"port\":%u,\"pool\":\"%s\",\"inject_ring\":\"%s\",\"capture_ring\":\"%s\","
+                        "\"capture_consumers\":%u,\"injected\":%lu,\"inject_dropped\":%lu,"
+                        "\"captured\":%lu,\"capture_dropped\":%lu}",
+                        i ? "," : "", p->port_id, p->pool_name, p->inject_ring, p->capture_ring,
+                        p->capture_consumers, p->injected, p->inject_dropped,
+                        p->captured, p->capture_dropped);
+    }
+    if (len < (int)size) snprintf(buf + len, size - len, "]}\n");
+}
+
+// Resolver thread: control frames of tx_port and those handed over by the
+// RX lcores, frames injected by secondaries, pending ARP requests, periodic
+// LLDPDUs and the device discovery sweep
+void* arp_resolver_thread(__rte_unused void *arg) {
+    struct rte_mbuf *bufs[BURST_SIZE];
+    uint64_t next_lldp = rte_get_tsc_cycles();
+    uint64_t next_cleanup = next_lldp;
+    uint64_t next_reap = next_lldp;
+    
+    while (!force_quit) {
+        for (int b = 0; b < ARP_RX_BURSTS; b++) {
+            uint16_t nb_rx = rte_eth_rx_burst(tx_port, 0, bufs, BURST_SIZE);
+            for (uint16_t i = 0; i < nb_rx; i++) {
+                int type = control_frame_type(bufs[i]);
+                if (type == RTE_ETHER_TYPE_ARP) {
+                    dpdk_inspect_packet_for_discovery(tx_port, bufs[i]);
+                    arp_input(tx_port, bufs[i]);
+                } else if (type == RTE_ETHER_TYPE_LLDP || type == CDP_FRAME) {
+                    topology_input(tx_port, bufs[i], type == CDP_FRAME);
+                }
+                mp_capture(tx_port, bufs[i]);
+            }
+            rte_pktmbuf_free_bulk(bufs, nb_rx);
+            if (nb_rx < BURST_SIZE) break;
+        }
+        
+        unsigned nb = rte_ring_sc_dequeue_burst(arp_ring, (void**)bufs, BURST_SIZE, NULL);
+        for (unsigned i = 0; i < nb; i++) {
+            int type = control_frame_type(bufs[i]);
+            if (type == RTE_ETHER_TYPE_ARP) {
+                dpdk_inspect_packet_for_discovery(bufs[i]->port, bufs[i]);
+                arp_input(bufs[i]->port, bufs[i]);
+            } else {
+                topology_input(bufs[i]->port, bufs[i], type == CDP_FRAME);
+            }
+        }
+        rte_pktmbuf_free_bulk(bufs, nb);
+        
+        if (mp_info) mp_inject_drain();
+        
+        uint64_t now = rte_get_tsc_cycles();
+        arp_send_requests(now);
+        dpdk_scan_subnet_poll();
+        
+        if (mp_info && now >= next_reap) {
+            mp_reap_consumers();
+            next_reap = now + rte_get_tsc_hz() * MP_REAP_SEC;
+        }
+        if (now >= next_cleanup) {
+            dpdk_cleanup_discovered_devices();
+            next_cleanup = now + rte_get_tsc_hz() * DISCOVERY_CLEANUP_SEC;
+        }
+        
+        if (lldp_interval_sec > 0 && now >= next_lldp) {
+            send_lldp_packet(tx_port);
+            if (dual_port_mode) send_lldp_packet(rx_port);
+            next_lldp = now + rte_get_tsc_hz() * lldp_interval_sec;
+        }
+        
+        usleep(ARP_POLL_US);
+    }
+    return NULL;
+}
+
+// Create the default profile used when none are configured
+void create_default_profile(void) {
+    RTE_LOG(INFO, USER1, "No profiles configured, creating default profile\n");
+    
+    traffic_profile *prof = &profiles[0];
+    memset(prof, 0, sizeof(traffic_profile));
+    
+    strcpy(prof->name, "default");
+    prof->dst_ip = 0xC0A80202;           // 192.168.2.2
+    prof->src_ip = 0xC0A80101;           // 192.168.1.1
+    prof->src_ip_count = 1;
+    prof->gateway_ip = 0;
+    prof->resolve_mac = false;
+    prof->use_ipv6 = false;
+    
+    prof->src_port_min = 10000;
+    prof->src_port_max = 10100;
+    prof->dst_port = 5000;
+    
+    prof->src_mac = 0x001122334455ULL;
+    prof->dst_mac = 0x00AABBCCDDEEULL;
+    prof->mac_iterate = MAC_ITER_NONE;
+    
+    prof->protocol = PROTO_UDP;
+    prof->packet_size = 1400;
+    prof->rate_mbps = 100.0;
+    prof->burst_size = 32;
+    
+    // Calculate inter-packet gap for ~100 Mbps with 1400 byte packets
+    // Formula: IPG (ns) = (packet_size * 8 * 1000) / rate_mbps
+    prof->inter_packet_gap_ns = (prof->packet_size * 8 * 1000) / prof->rate_mbps;
+    
+    // CRITICAL FIX: Pre-calculate TSC cycles to prevent overflow in TX loop
+    uint64_t tsc_hz = rte_get_tsc_hz();
+    prof->inter_packet_gap_cycles = (prof->inter_packet_gap_ns * tsc_hz) / 1000000000ULL;
+    
+    RTE_LOG(INFO, USER1, "  Inter-packet gap: %lu ns = %lu cycles (@ %lu Hz)\n",
+            prof->inter_packet_gap_ns, prof->inter_packet_gap_cycles, tsc_hz);
+    
+    prof->vlan_enabled = false;
+    prof->vlan_id = 0;
+    prof->dscp = 0;
+    
+    prof->payload_type = PAYLOAD_INCREMENT;
+    prof->custom_payload_len = 0;
+    
+    prof->sequence_num = 0;
+    prof->stream_id = 1;
+    
+    num_profiles = 1;
+    
+    RTE_LOG(INFO, USER1, "✓ Created default profile: UDP 192.168.1.1 -> 192.168.2.2:%u, %u bytes @ %.1f Mbps\n",
+            prof->dst_port, prof->packet_size, prof->rate_mbps);
+}
+
+// Launch TX and RX lcores
+void start_traffic(void) {
+    if (num_profiles == 0) {
+        create_default_profile();
+    }
+    
+    // Cached next hops only: the control thread and the test threads resolve
+    // before they get here, and trials must not wait for ARP
+    bool arp_pending;
+    arp_queue_profiles();
+    const char *arp_err = arp_apply_profiles(&arp_pending);
+    if (arp_err || arp_pending) {
+        RTE_LOG(WARNING, USER1, "%s, sending to the configured MAC\n",
+                arp_err ? arp_err : "ARP resolution pending");
+    }
+    
+    if (num_rx_lcores > 0) {
+        microburst_reset();
+    }
+    
+    running = true;
+    tx_active = true;
+    traffic_start_tsc = rte_get_tsc_cycles();
+    rte_eal_mp_remote_launch(lcore_main, NULL, SKIP_MAIN);
+}
+
+// Stop TX, give in-flight frames 'drain_ms' to arrive, then stop RX
+void stop_traffic(unsigned drain_ms) {
+    tx_active = false;
+    if (drain_ms > 0 && num_rx_lcores > 0) {
+        usleep(drain_ms * 1000);
+    }
+    running = false;
+    rte_eal_mp_wait_lcore();
+}
+
+// Zero TX and RX counters (lcores must be stopped)
+void reset_traffic_stats(void) {
+    memset(stream_max_seq, 0, sizeof(stream_max_seq));
+    
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        if (lcore_confs[lcore_id].tx) {
+            memset(lcore_confs[lcore_id].tx, 0, sizeof(tx_lcore_state));
+        }
+        
+        rx_lcore_state *state = lcore_confs[lcore_id].rx;
+        if (!state) continue;
+        
+        for (int s = 0; s < MAX_STREAMS; s++) {
+            rx_stream_state *st = &state->streams[s];
+            uint64_t *window = st->window;
+            uint64_t *hist = st->latency_hist;
+            
+            memset(st, 0, sizeof(*st));
+            memset(window, 0, SEQ_WINDOW_WORDS * sizeof(uint64_t));
+            memset(hist, 0, LAT_HIST_BUCKETS * sizeof(uint64_t));
+            st->window = window;
+            st->latency_hist = hist;
+        }
+        
+        state->packets_received = 0;
+        state->bytes_received = 0;
+        state->unsigned_packets = 0;
+        state->flow_table_full = 0;
+        memset(&state->cycles, 0, sizeof(state->cycles));
+        if (state->flow_hash) {
+            rte_hash_reset(state->flow_hash);
+            memset(state->flows, 0, (size_t)flow_table_entries * sizeof(flow_entry));
+        }
+        if (state->sketch) {
+            memset(state->sketch, 0, sizeof(flow_sketch));
+        }
+    }
+}
+
+// ============================================================================
+// SHARED-MEMORY STATISTICS
+// ============================================================================
+// A publisher thread copies all counters into a POSIX shared-memory region
+// (layout in netgen_stats_shm.h) at --stats-hz, under a seqlock. Collectors
+// map it and sample without syscalls, JSON or the control thread.
+
+static netgen_stats_region *stats_shm = NULL;
+
+// Serialises every rte_eth_stats_get / rte_eth_xstats_get caller: the
+// publisher, the metrics thread and telemetry callbacks all read the NIC.
+static pthread_mutex_t ethdev_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int stats_shm_create(void) {
+    int fd = shm_open(NETGEN_STATS_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        perror("shm_open");
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(netgen_stats_region)) == -1) {
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+    
+    void *addr = mmap(NULL, sizeof(netgen_stats_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    
+    stats_shm = (netgen_stats_region*)addr;
+    memset(stats_shm, 0, sizeof(*stats_shm));
+    
+    netgen_stats_header *hdr = &stats_shm->header;
+    hdr->size = sizeof(netgen_stats_region);
+    hdr->version = NETGEN_STATS_VERSION;
+    hdr->tsc_hz = rte_get_tsc_hz();
+    hdr->publish_hz = stats_publish_hz;
+    hdr->profiles_offset = offsetof(netgen_stats_region, profiles);
+    hdr->profile_stride = sizeof(netgen_stats_profile);
+    hdr->ports_offset = offsetof(netgen_stats_region, ports);
+    hdr->port_stride = sizeof(netgen_stats_port);
+    hdr->lcores_offset = offsetof(netgen_stats_region, lcores);
+    hdr->lcore_stride = sizeof(netgen_stats_lcore);
+    
+    // Magic last: readers ignore the region until the layout is filled in
+    rte_smp_wmb();
+    hdr->magic = NETGEN_STATS_MAGIC;
+    
+    printf("Statistics published in shared memory %s (%u Hz)\n", NETGEN_STATS_SHM_NAME, stats_publish_hz);
+    return 0;
+}
+
+void stats_shm_destroy(void) {
+    if (!stats_shm) return;
+    munmap(stats_shm, sizeof(netgen_stats_region));
+    shm_unlink(NETGEN_STATS_SHM_NAME);
+    stats_shm = NULL;
+}
+
+// Gather a full snapshot into 'snap' (outside the seqlock)
+static void stats_shm_collect_cycles(netgen_stats_lcore *out, const lcore_cycle_stats *cs) {
+    static_assert(TX_STAGE_MAX == NETGEN_STATS_TX_STAGES, "TX stage list out of sync");
+    out->busy_cycles = cs->busy_cycles;
+    out->idle_cycles = cs->idle_cycles;
+    out->busy_polls = cs->busy_polls;
+    out->idle_polls = cs->idle_polls;
+    for (int i = 0; i < TX_STAGE_MAX; i++) out->stage_cycles[i] = cs->stage_cycles[i];
+    out->tx_queue_full = cs->tx_queue_full;
+    out->alloc_failures = cs->alloc_failures;
+}
+
+static void stats_shm_collect(netgen_stats_region *snap) {
+    uint64_t hist[LAT_HIST_BUCKETS];
+    
+    uint32_t n = RTE_MIN((uint32_t)num_profiles, (uint32_t)NETGEN_STATS_MAX_PROFILES);
+    for (uint32_t i = 0; i < n; i++) {
+        const traffic_profile *prof = &profiles[i];
+        netgen_stats_profile *out = &snap->profiles[i];
+        
+        tx_counters cnt;
+        aggregate_tx_stats(i, &cnt);
+        
+        snprintf(out->name, sizeof(out->name), "%s", prof->name);
+        out->stream_id = prof->stream_id;
+        out->packets_sent = cnt.packets_sent;
+        out->bytes_sent = cnt.bytes_sent;
+        out->packets_dropped = cnt.packets_dropped;
+        if (prof->stream_id >= MAX_STREAMS) continue;
+        
+        rx_stream_state st;
+        aggregate_stream_stats(prof->stream_id, &st, hist);
+        uint64_t unique = st.in_order + st.out_of_order + st.late_arrivals;
+        
+        out->packets_received = unique + st.duplicates;
+        out->bytes_received = st.bytes;
+        out->lost_packets = cnt.packets_sent > unique ? cnt.packets_sent - unique : 0;
+        out->out_of_order = st.out_of_order;
+        out->duplicates = st.duplicates;
+        out->late_arrivals = st.late_arrivals;
+        out->latency_count = st.latency_count;
+        out->latency_min_ns = st.latency_min_ns;
+        out->latency_avg_ns = st.latency_count ? st.latency_sum_ns / st.latency_count : 0;
+        out->latency_max_ns = st.latency_max_ns;
+        out->latency_p50_ns = lat_hist_quantile(hist, st.latency_count, 500);
+        out->latency_p99_ns = lat_hist_quantile(hist, st.latency_count, 990);
+        out->latency_p999_ns = lat_hist_quantile(hist, st.latency_count, 999);
+        out->jitter_ns = st.jitter_q4 >> 4;
+        out->latency_sum_ns = st.latency_sum_ns;
+        
+        // Re-bucket the log histogram by bucket midpoint
+        static const uint64_t bounds[] = NETGEN_STATS_LAT_BOUNDS_NS;
+        uint32_t k = 0;
+        memset(out->latency_buckets, 0, sizeof(out->latency_buckets));
+        for (uint32_t b = 0; b < LAT_HIST_BUCKETS; b++) {
+            while (k < RTE_DIM(bounds) && lat_hist_value(b) > bounds[k]) k++;
+            out->latency_buckets[k] += hist[b];
+        }
+    }
+    snap->header.num_profiles = n;
+    
+    int ports[NETGEN_STATS_MAX_PORTS] = {tx_port, rx_port};
+    uint32_t nb_ports = dual_port_mode ? 2 : 1;
+    for (uint32_t i = 0; i < nb_ports; i++) {
+        struct rte_eth_stats eth_stats;
+        netgen_stats_port *out = &snap->ports[i];
+        
+        out->port_id = ports[i];
+        pthread_mutex_lock(&ethdev_stats_mutex);
+        int ret = rte_eth_stats_get(ports[i], &eth_stats);
+        pthread_mutex_unlock(&ethdev_stats_mutex);
+        if (ret != 0) continue;
+        out->ipackets = eth_stats.ipackets;
+        out->opackets = eth_stats.opackets;
+        out->ibytes = eth_stats.ibytes;
+        out->obytes = eth_stats.obytes;
+        out->imissed = eth_stats.imissed;
+        out->ierrors = eth_stats.ierrors;
+        out->oerrors = eth_stats.oerrors;
+        out->rx_nombuf = eth_stats.rx_nombuf;
+    }
+    snap->header.num_ports = nb_ports;
+    
+    uint32_t nl = 0;
+    unsigned lcore_id;
+    RTE_LCORE_FOREACH_WORKER(lcore_id) {
+        const lcore_conf *conf = &lcore_confs[lcore_id];
+        if (nl == NETGEN_STATS_MAX_LCORES) break;
+        
+        netgen_stats_lcore *out = &snap->lcores[nl++];
+        out->lcore_id = lcore_id;
+        out->queue_id = conf->queue_id;
+        
+        if (conf->role == LCORE_ROLE_TX && conf->tx) {
+            out->role = NETGEN_STATS_LCORE_TX;
+            out->packets = conf->tx->total.packets_sent;
+            out->bytes = conf->tx->total.bytes_sent;
+            stats_shm_collect_cycles(out, &conf->tx->cycles);
+        } else if (conf->role == LCORE_ROLE_RX && conf->rx) {
+            out->role = NETGEN_STATS_LCORE_RX;
+            out->packets = conf->rx->packets_received;
+            out->bytes = conf->rx->bytes_received;
+            out->unsigned_packets = conf->rx->unsigned_packets;
+            stats_shm_collect_cycles(out, &conf->rx->cycles);
+        } else {
+            out->role = NETGEN_STATS_LCORE_IDLE;
+        }
+    }
+    snap->header.num_lcores = nl;
+}
+
+// Copy a snapshot into the shared region under the seqlock
+static void stats_shm_publish(const netgen_stats_region *snap) {
+    netgen_stats_header *hdr = &stats_shm->header;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    
+    hdr->seq++;
+    rte_smp_wmb();
+    
+    memcpy(stats_shm->profiles, snap->profiles, sizeof(snap->profiles));
+    memcpy(stats_shm->ports, snap->ports, sizeof(snap->ports));
+    memcpy(stats_shm->lcores, snap->lcores, sizeof(snap->lcores));
+    hdr->num_profiles = snap->header.num_profiles;
+    hdr->num_ports = snap->header.num_ports;
+    hdr->num_lcores = snap->header.num_lcores;
+    hdr->running = running;
+    hdr->update_count++;
+    hdr->update_tsc = rte_get_tsc_cycles();
+    hdr->update_unix_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    
+    rte_smp_wmb();
+    hdr->seq++;
+}
+
+// Copy the last published snapshot out of the shared region, retrying while
+// the publisher is mid-update. Without a publisher (--stats-hz 0, or before
+// its first update) the snapshot is collected directly.
+static void stats_shm_read(netgen_stats_region *out) {
+    const netgen_stats_header *hdr = stats_shm ? &stats_shm->header : NULL;
+    if (!hdr || stats_publish_hz == 0 || hdr->update_count == 0) {
+        stats_shm_collect(out);
+        return;
+    }
+    
+    uint64_t s1;
+    do {
+        s1 = hdr->seq;
+        rte_smp_rmb();
+        if (s1 & 1) {
+            rte_pause();
+            continue;
+        }
+        memcpy(out, stats_shm, sizeof(*out));
+        rte_smp_rmb();
+    } while ((s1 & 1) || hdr->seq != s1);
+}
+
+void* stats_publisher_thread(__rte_unused void *arg) {
+    static netgen_stats_region snap;
+    uint64_t period = rte_get_tsc_hz() / stats_publish_hz;
+    uint64_t next = rte_get_tsc_cycles();
+    
+    while (!force_quit) {
+        memset(&snap, 0, sizeof(snap));
+        stats_shm_collect(&snap);
+        stats_shm_publish(&snap);
+        
+        next += period;
+        uint64_t now = rte_get_tsc_cycles();
+        if (next > now) {
+            usleep((next - now) * 1000000 / rte_get_tsc_hz());
+        } else {
+            next = now;
+        }
+    }
+    return NULL;
+}
+
+// ============================================================================
+// RATE TIME SERIES
+// ============================================================================
+// A sampler thread snapshots cumulative TX/RX counters per profile and per
+// port every --timeseries-us into a fixed ring. Rates are the deltas
+// between consecutive samples; "timeseries" returns them incrementally
+// (pass the returned next_seq as "since"). A request may ask for a coarser
+// "interval_us": it then gets every n-th sample, the sampler itself keeps
+// --timeseries-us for all clients.
+
+#define TIMESERIES_RING_SIZE 4096
+#define TIMESERIES_MIN_US 1000
+#define TIMESERIES_MAX_BATCH 4096
+
+struct timeseries_sample {
+    netgen_timeseries_sample head;
+    netgen_timeseries_counters profiles[MAX_PROFILES];
+    uint64_t tsc;               // Rates use this; head.unix_ns is only the label
+};
+
+static timeseries_sample *timeseries_ring = NULL;
+static volatile uint64_t timeseries_head = 0;       // Next sequence number
+static uint32_t timeseries_interval_us = 10000;        // Set once at startup
+static uint32_t timeseries_num_profiles = 0;
+
+int timeseries_create(void) {
+    timeseries_ring = (timeseries_sample*)calloc(TIMESERIES_RING_SIZE, sizeof(timeseries_sample));
+    if (!timeseries_ring) {
+        fprintf(stderr, "Failed to allocate time-series ring\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Cumulative counters right now (sampler thread)
+static void timeseries_collect(timeseries_sample *smp) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    
+    memset(smp, 0, sizeof(*smp));
+    smp->head.unix_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    smp->tsc = rte_get_tsc_cycles();
+    
+    int n = num_profiles;
+    for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+        const tx_lcore_state *tx = lcore_confs[lcore_id].tx;
+        const rx_lcore_state *rx = lcore_confs[lcore_id].rx;
+        
+        if (tx) {
+            smp->head.port.tx_packets += tx->total.packets_sent;
+            smp->head.port.tx_bytes += tx->total.bytes_sent;
+            for (int i = 0; i < n; i++) {
+                smp->profiles[i].tx_packets += tx->profiles[i].packets_sent;
+                smp->profiles[i].tx_bytes += tx->profiles[i].bytes_sent;
+            }
+        }
+        if (rx) {
+            smp->head.port.rx_packets += rx->packets_received;
+            smp->head.port.rx_bytes += rx->bytes_received;
+            for (int i = 0; i < n; i++) {
+                uint16_t stream_id = profiles[i].stream_id;
+                if (stream_id >= MAX_STREAMS) continue;
+                const rx_stream_state *st = &rx->streams[stream_id];
+                smp->profiles[i].rx_packets += st->in_order + st->out_of_order +
+                                               st->late_arrivals + st->duplicates;
+                smp->profiles[i].rx_bytes += st->bytes;
+            }
+        }
+    }
+    timeseries_num_profiles = n;
+}
+
+void* timeseries_thread(__rte_unused void *arg) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    
+    while (!force_quit) {
+        uint64_t seq = timeseries_head;
+        timeseries_collect(&timeseries_ring[seq % TIMESERIES_RING_SIZE]);
+        rte_smp_wmb();
+        timeseries_head = seq + 1;
+        
+        // Absolute deadlines so the interval does not drift
+        uint64_t nsec = next.tv_nsec + (uint64_t)timeseries_interval_us * 1000;
+        next.tv_sec += nsec / 1000000000ULL;
+        next.tv_nsec = nsec % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+// Copy samples out of the ring: the one before 'since' as the rate base,
+// then every sample in [since, head) whose sequence number is a multiple
+// of 'step', at most 'max' of them. Returns the sequence number of
+// samples[0] and sets *next to the "since" of the following request.
+// Samples the sampler overwrote during the copy are dropped.
+static uint64_t timeseries_copy(uint64_t since, uint32_t max, uint32_t step,
+                                std::vector<timeseries_sample> &samples, uint64_t *next) {
+    uint64_t head = timeseries_head;
+    rte_smp_rmb();
+    
+    // A cursor from the future (engine restarted) resumes at the head;
+    // keep clear of the slot being rewritten
+    since = RTE_MIN(since, head);
+    uint64_t oldest = head > TIMESERIES_RING_SIZE - 1 ? head - (TIMESERIES_RING_SIZE - 1) : 0;
+    uint64_t first = RTE_MAX(since > 0 ? since - 1 : 0, oldest);
+    
+    // Newest 'max' multiples of 'step' after the base
+    uint64_t lo = first / step * step + step;
+    uint64_t hi = head > 0 ? (head - 1) / step * step : 0;
+    if (hi >= lo && (hi - lo) / step >= max) {
+        first = hi - (uint64_t)max * step;
+        lo = first + step;
+    }
+    
+    std::vector<uint64_t> seqs;
+    samples.clear();
+    if (first < head) seqs.push_back(first);
+    for (uint64_t seq = lo; seq < head; seq += step) seqs.push_back(seq);
+    for (uint64_t seq : seqs) samples.push_back(timeseries_ring[seq % TIMESERIES_RING_SIZE]);
+    
+    rte_smp_rmb();
+    uint64_t now_oldest = timeseries_head > TIMESERIES_RING_SIZE - 1 ?
+                          timeseries_head - (TIMESERIES_RING_SIZE - 1) : 0;
+    size_t lost = 0;
+    while (lost < seqs.size() && seqs[lost] < now_oldest) lost++;
+    samples.erase(samples.begin(), samples.begin() + lost);
+    
+    *next = seqs.empty() ? since : seqs.back() + 1;
+    return lost < seqs.size() ? seqs[lost] : *next;
+}
+
+// Seconds between two samples
+static inline double timeseries_dt(const timeseries_sample *a, const timeseries_sample *b) {
+    return b->tsc > a->tsc ? (double)(b->tsc - a->tsc) / rte_get_tsc_hz() : 0;
+}
+
+// Counter increase between two samples; a counter that went back was
+// cleared by reset_traffic_stats() (every test trial does) and counts 0
+static inline uint64_t timeseries_delta(uint64_t c0, uint64_t c1) {
+    return c1 >= c0 ? c1 - c0 : 0;
+}
+
+// TX and RX rates over roughly the last 'window_ms', from the ring. The
+// window restarts after the last counter reset inside it. Returns false
+// when the sampler has not recorded enough yet.
+static bool timeseries_recent_rate(uint32_t window_ms, double *tx_mbps, double *rx_mbps) {
+    if (!timeseries_ring) return false;
+    
+    uint64_t head = timeseries_head;
+    rte_smp_rmb();
+    uint64_t back = RTE_MAX((uint64_t)window_ms * 1000 / timeseries_interval_us, (uint64_t)1);
+    back = RTE_MIN(back, (uint64_t)TIMESERIES_RING_SIZE / 2);
+    if (head <= back) return false;
+    
+    uint64_t first = head - 1 - back;
+    for (uint64_t seq = first + 1; seq < head; seq++) {
+        const netgen_timeseries_counters *c0 = &timeseries_ring[(seq - 1) % TIMESERIES_RING_SIZE].head.port;
+        const netgen_timeseries_counters *c1 = &timeseries_ring[seq % TIMESERIES_RING_SIZE].head.port;
+        if (c1->tx_bytes < c0->tx_bytes || c1->rx_bytes < c0->rx_bytes) first = seq;
+    }
+    if (first == head - 1) return false;
+    
+    const timeseries_sample *a = &timeseries_ring[first % TIMESERIES_RING_SIZE];
+    const timeseries_sample *b = &timeseries_ring[(head - 1) % TIMESERIES_RING_SIZE];
+    double dt = timeseries_dt(a, b);
+    if (dt <= 0) return false;
+    
+    *tx_mbps = timeseries_delta(a->head.port.tx_bytes, b->head.port.tx_bytes) * 8.0 / dt / 1e6;
+    *rx_mbps = timeseries_delta(a->head.port.rx_bytes, b->head.port.rx_bytes) * 8.0 / dt / 1e6;
+    return true;
+}
+
+// Append "[r0,r1,...]" of per-second rates of one counter
+static void timeseries_append_rates(std::string &out, const std::vector<timeseries_sample> &samples,
+                                    const netgen_timeseries_counters *(*pick)(const timeseries_sample*, int),
+                                    int index, bool bits, bool tx) {
+    char num[32];
+    out += '[';
+    for (size_t k = 1; k < samples.size(); k++) {
+        const netgen_timeseries_counters *c0 = pick(&samples[k - 1], index);
+        const netgen_timeseries_counters *c1 = pick(&samples[k], index);
+        double dt = timeseries_dt(&samples[k - 1], &samples[k]);
+        uint64_t delta = bits ? (tx ? timeseries_delta(c0->tx_bytes, c1->tx_bytes) :
+                                      timeseries_delta(c0->rx_bytes, c1->rx_bytes)) * 8 :
+                                (tx ? timeseries_delta(c0->tx_packets, c1->tx_packets) :
+                                      timeseries_delta(c0->rx_packets, c1->rx_packets));
+        snprintf(num, sizeof(num), "%s%.0f", k > 1 ? "," : "", dt > 0 ? delta / dt : 0.0);
+        out += num;
+    }
+    out += ']';
+}
+
+static const netgen_timeseries_counters* timeseries_port(const timeseries_sample *smp, __rte_unused int index) {
+    return &smp->head.port;
+}
+
+static const netgen_timeseries_counters* timeseries_profile(const timeseries_sample *smp, int index) {
+    return &smp->profiles[index];
+}
+
+// Columnar JSON batch: per interval TX/RX pps and bps for the ports and
+// each profile. samples[0] is only the rate base.
+static void timeseries_format_json(std::string &out, uint32_t interval_us, uint64_t first_seq,
+                                   uint64_t next_seq, const std::vector<timeseries_sample> &samples) {
+    char buf[256];
+    uint32_t n = timeseries_num_profiles;
+    
+    snprintf(buf, sizeof(buf),
+            "{\"status\":\"success\",\"data\":{\"interval_us\":%u,\"first_seq\":%lu,"
+            "\"next_seq\":%lu,\"samples\":%zu,\"t_ns\":[",
+            interval_us, first_seq + 1, next_seq,
+            samples.empty() ? 0 : samples.size() - 1);
+    out += buf;
+    for (size_t k = 1; k < samples.size(); k++) {
+        snprintf(buf, sizeof(buf), "%s%lu", k > 1 ? "," : "", samples[k].head.unix_ns);
+        out += buf;
+    }
+    
+    out += "],\"ports\":{\"tx_pps\":";
+    timeseries_append_rates(out, samples, timeseries_port, 0, false, true);
+    out += ",\"tx_bps\":";
+    timeseries_append_rates(out, samples, timeseries_port, 0, true, true);
+    out += ",\"rx_pps\":";
+    timeseries_append_rates(out, samples, timeseries_port, 0, false, false);
+    out += ",\"rx_bps\":";
+    timeseries_append_rates(out, samples, timeseries_port, 0, true, false);
+    out += "},\"profiles\":[";
+    
+    for (uint32_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"stream_id\":%u,\"name\":\"%s\",\"tx_pps\":",
+                 i > 0 ? "," : "", profiles[i].stream_id, profiles[i].name);
+        out += buf;
+        timeseries_append_rates(out, samples, timeseries_profile, i, false, true);
+        out += ",\"tx_bps\":";
+        timeseries_append_rates(out, samples, timeseries_profile, i, true, true);
+        out += ",\"rx_pps\":";
+        timeseries_append_rates(out, samples, timeseries_profile, i, false, false);
+        out += ",\"rx_bps\":";
+        timeseries_append_rates(out, samples, timeseries_profile, i, true, false);
+        out += '}';
+    }
+    out += "]}}\n";
+}
+
+// Binary batch (layout in netgen_stats_shm.h): cumulative counters
+static void timeseries_format_binary(std::string &out, uint32_t interval_us, uint64_t first_seq,
+                                     uint64_t next_seq, const std::vector<timeseries_sample> &samples) {
+    uint32_t n = timeseries_num_profiles;
+    uint32_t sample_size = sizeof(netgen_timeseries_sample) + n * sizeof(netgen_timeseries_counters);
+    
+    netgen_timeseries_header hdr;
+    hdr.magic = NETGEN_TIMESERIES_MAGIC;
+    hdr.version = NETGEN_STATS_VERSION;
+    hdr.interval_us = interval_us;
+    hdr.num_profiles = n;
+    hdr.num_samples = samples.size();
+    hdr.sample_size = sample_size;
+    hdr.first_seq = first_seq;
+    hdr.next_seq = next_seq;
+    
+    out.reserve(sizeof(hdr) + (size_t)sample_size * samples.size());
+    out.append((const char*)&hdr, sizeof(hdr));
+    for (const timeseries_sample &smp : samples) {
+        out.append((const char*)&smp.head, sizeof(smp.head));
+        out.append((const char*)smp.profiles, n * sizeof(netgen_timeseries_counters));
+    }
+}
+
+// ============================================================================
+// CONTROL CHANNEL
+// ============================================================================
+// Clients keep their connection open and send any number of commands.
+// The first byte picks the framing: '{' selects newline-delimited JSON
+// (the original protocol), anything else a 4-byte big-endian length prefix
+// per message in both directions.
+
+#define CONTROL_MAX_CLIENTS 64
+#define CONTROL_MAX_MESSAGE (16u << 20)
+#define CONTROL_SEND_TIMEOUT_MS 1000
+
+enum control_framing {
+    CONTROL_FRAMING_UNKNOWN = 0,
+    CONTROL_FRAMING_LINE,
+    CONTROL_FRAMING_LENGTH
+};
+
+struct control_client {
+    int framing;
+    std::string rx_buf;         // Received bytes not yet handled
+    bool watcher;               // Handed to rfc2544_watch; leaves the epoll set
+};
+
+static std::map<int, control_client> control_clients;  // Control thread only
+
+// Send one message with the given framing, retrying partial writes
+static bool control_write(int fd, int framing, const char *data, size_t len) {
+    std::string msg;
+    if (framing == CONTROL_FRAMING_LENGTH) {
+        uint32_t be_len = htonl(len);
+        msg.append((const char*)&be_len, sizeof(be_len));
+    }
+    msg.append(data, len);
+    
+    size_t sent = 0;
+    while (sent < msg.size()) {
+        ssize_t n = send(fd, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Reply to the client whose command is being handled
+static void control_send(int client_sock, const char *data, size_t len) {
+    auto it = control_clients.find(client_sock);
+    control_write(client_sock, it != control_clients.end() ? it->second.framing : CONTROL_FRAMING_LINE,
+                  data, len);
+}
+
+// ============================================================================
+// OPENMETRICS EXPORTER
+// ============================================================================
+// Minimal HTTP listener (--metrics-port) serving GET /metrics in OpenMetrics
+// text format. It runs on its own thread and renders from the same
+// lock-free snapshot as the shared-memory publisher, so scrapes never
+// block the TX/RX lcores.
+
+#define METRICS_MAX_XSTATS 512
+
+static unsigned metrics_port = 9464;        // --metrics-port (0 = off)
+
+// Latency histogram bounds exported as "le" buckets (seconds)
+static const uint64_t metrics_latency_le_ns[] = NETGEN_STATS_LAT_BOUNDS_NS;
+static_assert(RTE_DIM(metrics_latency_le_ns) + 1 == NETGEN_STATS_LAT_BUCKETS, "latency bucket count");
+
+struct metrics_xstats {
+    uint16_t port;
+    int count;                              // -1 until the names are read
+    struct rte_eth_xstat_name *names;
+    struct rte_eth_xstat *values;
+};
+
+static void metrics_printf(std::string &out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void metrics_printf(std::string &out, const char *fmt, ...) {
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) out.append(line, RTE_MIN((size_t)n, sizeof(line) - 1));
+}
+
+// Label values may not contain '"', '\\' or newlines unescaped
+static std::string metrics_label(const char *value) {
+    std::string out;
+    for (const char *c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') out += '\\';
+        if (*c == '\n') { out += "\\n"; continue; }
+        out += *c;
+    }
+    return out;
+}
+
+static void metrics_render_xstats(std::string &out, metrics_xstats *xs) {
+    pthread_mutex_lock(&ethdev_stats_mutex);
+    if (xs->count < 0) {
+        int n = rte_eth_xstats_get_names(xs->port, NULL, 0);
+        n = RTE_MIN(RTE_MAX(n, 0), METRICS_MAX_XSTATS);
+        xs->names = (struct rte_eth_xstat_name*)calloc(RTE_MAX(n, 1), sizeof(*xs->names));
+        xs->values = (struct rte_eth_xstat*)calloc(RTE_MAX(n, 1), sizeof(*xs->values));
+        xs->count = rte_eth_xstats_get_names(xs->port, xs->names, n) == n ? n : 0;
+    }
+    
+    int n = rte_eth_xstats_get(xs->port, xs->values, xs->count);
+    pthread_mutex_unlock(&ethdev_stats_mutex);
+    for (int i = 0; i < n && i < xs->count; i++) {
+        if (xs->values[i].id >= (uint64_t)xs->count) continue;
+        metrics_printf(out, "netgen_port_xstat_total{port=\"%u\",name=\"%s\"} %lu\n", xs->port,
+                       metrics_label(xs->names[xs->values[i].id].name).c_str(), xs->values[i].value);
+    }
+}
+
+static void metrics_render(std::string &out, metrics_xstats *xstats, uint32_t nb_xstats) {
+    static netgen_stats_region snap;
+    
+    memset(&snap, 0, sizeof(snap));
+    stats_shm_read(&snap);
+    
+    metrics_printf(out, "# TYPE netgen_running gauge\nnetgen_running %d\n", running ? 1 : 0);
+    
+    // Per profile
+    static const struct { const char *name; const char *help; size_t offset; } profile_counters[] = {
+        {"netgen_profile_tx_packets", "Frames sent", offsetof(netgen_stats_profile, packets_sent)},
+        {"netgen_profile_tx_bytes", "Bytes sent", offsetof(netgen_stats_profile, bytes_sent)},
+        {"netgen_profile_tx_dropped", "Frames dropped locally by TX", offsetof(netgen_stats_profile, packets_dropped)},
+        {"netgen_profile_rx_packets", "Frames received", offsetof(netgen_stats_profile, packets_received)},
+        {"netgen_profile_rx_bytes", "Bytes received", offsetof(netgen_stats_profile, bytes_received)},
+        {"netgen_profile_lost", "Frames lost (sent - unique received)", offsetof(netgen_stats_profile, lost_packets)},
+        {"netgen_profile_out_of_order", "Frames received out of order", offsetof(netgen_stats_profile, out_of_order)},
+        {"netgen_profile_duplicates", "Duplicate frames", offsetof(netgen_stats_profile, duplicates)},
+        {"netgen_profile_late", "Frames older than the sequence window", offsetof(netgen_stats_profile, late_arrivals)},
+    };
+    for (size_t c = 0; c < RTE_DIM(profile_counters); c++) {
+        metrics_printf(out, "# TYPE %s counter\n# HELP %s %s\n", profile_counters[c].name,
+                       profile_counters[c].name, profile_counters[c].help);
+        for (uint32_t i = 0; i < snap.header.num_profiles; i++) {
+            const netgen_stats_profile *p = &snap.profiles[i];
+            metrics_printf(out, "%s_total{profile=\"%s\",stream=\"%u\"} %lu\n", profile_counters[c].name,
+                           metrics_label(p->name).c_str(), p->stream_id,
+                           *(const uint64_t*)((const uint8_t*)p + profile_counters[c].offset));
+        }
+    }
+    
+    metrics_printf(out, "# TYPE netgen_profile_jitter_seconds gauge\n"
+                        "# HELP netgen_profile_jitter_seconds RFC 3550 interarrival jitter\n");
+    for (uint32_t i = 0; i < snap.header.num_profiles; i++) {
+        const netgen_stats_profile *p = &snap.profiles[i];
+        metrics_printf(out, "netgen_profile_jitter_seconds{profile=\"%s\",stream=\"%u\"} %.9f\n",
+                       metrics_label(p->name).c_str(), p->stream_id, p->jitter_ns / 1e9);
+    }
+    
+    // Latency histograms as published in the snapshot; +Inf and _count are
+    // the sum of the same buckets so the histogram stays consistent
+    metrics_printf(out, "# TYPE netgen_latency_seconds histogram\n"
+                        "# HELP netgen_latency_seconds One-way latency of signed frames\n");
+    for (uint32_t i = 0; i < snap.header.num_profiles; i++) {
+        const netgen_stats_profile *p = &snap.profiles[i];
+        if (p->stream_id >= MAX_STREAMS) continue;
+        
+        std::string labels = "profile=\"" + metrics_label(p->name) + "\",stream=\"" +
+                             std::to_string(p->stream_id) + "\"";
+        
+        uint64_t cumulative = 0;
+        for (size_t k = 0; k < RTE_DIM(metrics_latency_le_ns); k++) {
+            cumulative += p->latency_buckets[k];
+            metrics_printf(out, "netgen_latency_seconds_bucket{%s,le=\"%g\"} %lu\n", labels.c_str(),
+                           metrics_latency_le_ns[k] / 1e9, cumulative);
+        }
+        cumulative += p->latency_buckets[RTE_DIM(metrics_latency_le_ns)];
+        metrics_printf(out, "netgen_latency_seconds_bucket{%s,le=\"+Inf\"} %lu\n", labels.c_str(), cumulative);
+        metrics_printf(out, "netgen_latency_seconds_count{%s} %lu\n", labels.c_str(), cumulative);
+        metrics_printf(out, "netgen_latency_seconds_sum{%s} %.9f\n", labels.c_str(), p->latency_sum_ns / 1e9);
+    }
+    
+    // Per lcore
+    metrics_printf(out, "# TYPE netgen_lcore_packets counter\n"
+                        "# HELP netgen_lcore_packets Frames sent (TX) or received (RX) by a worker lcore\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        metrics_printf(out, "netgen_lcore_packets_total{lcore=\"%u\",role=\"%s\",queue=\"%u\"} %lu\n",
+                       l->lcore_id, l->role == NETGEN_STATS_LCORE_TX ? "tx" :
+                       l->role == NETGEN_STATS_LCORE_RX ? "rx" : "idle", l->queue_id, l->packets);
+    }
+    metrics_printf(out, "# TYPE netgen_lcore_bytes counter\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        metrics_printf(out, "netgen_lcore_bytes_total{lcore=\"%u\",role=\"%s\",queue=\"%u\"} %lu\n",
+                       l->lcore_id, l->role == NETGEN_STATS_LCORE_TX ? "tx" :
+                       l->role == NETGEN_STATS_LCORE_RX ? "rx" : "idle", l->queue_id, l->bytes);
+    }
+#ifdef ENABLE_CYCLE_STATS
+    metrics_printf(out, "# TYPE netgen_lcore_cycles counter\n"
+                        "# HELP netgen_lcore_cycles TSC cycles spent in busy and idle polls\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        if (l->role == NETGEN_STATS_LCORE_IDLE) continue;
+        const char *role = l->role == NETGEN_STATS_LCORE_TX ? "tx" : "rx";
+        metrics_printf(out, "netgen_lcore_cycles_total{lcore=\"%u\",role=\"%s\",state=\"busy\"} %lu\n"
+                            "netgen_lcore_cycles_total{lcore=\"%u\",role=\"%s\",state=\"idle\"} %lu\n",
+                       l->lcore_id, role, l->busy_cycles, l->lcore_id, role, l->idle_cycles);
+    }
+    metrics_printf(out, "# TYPE netgen_lcore_stage_cycles counter\n"
+                        "# HELP netgen_lcore_stage_cycles TSC cycles of TX bursts by stage\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        if (l->role != NETGEN_STATS_LCORE_TX) continue;
+        for (int s = 0; s < TX_STAGE_MAX; s++) {
+            metrics_printf(out, "netgen_lcore_stage_cycles_total{lcore=\"%u\",stage=\"%s\"} %lu\n",
+                           l->lcore_id, tx_stage_names[s], l->stage_cycles[s]);
+        }
+    }
+#endif
+    metrics_printf(out, "# TYPE netgen_lcore_tx_queue_full counter\n"
+                        "# HELP netgen_lcore_tx_queue_full TX bursts the NIC queue did not fully accept\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        if (l->role != NETGEN_STATS_LCORE_TX) continue;
+        metrics_printf(out, "netgen_lcore_tx_queue_full_total{lcore=\"%u\",queue=\"%u\"} %lu\n",
+                       l->lcore_id, l->queue_id, l->tx_queue_full);
+    }
+    metrics_printf(out, "# TYPE netgen_lcore_alloc_failures counter\n"
+                        "# HELP netgen_lcore_alloc_failures Mempool allocations that failed on a TX lcore\n");
+    for (uint32_t i = 0; i < snap.header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap.lcores[i];
+        if (l->role != NETGEN_STATS_LCORE_TX) continue;
+        metrics_printf(out, "netgen_lcore_alloc_failures_total{lcore=\"%u\",queue=\"%u\"} %lu\n",
+                       l->lcore_id, l->queue_id, l->alloc_failures);
+    }
+    
+    // NIC counters
+    metrics_printf(out, "# TYPE netgen_port_xstat counter\n"
+                        "# HELP netgen_port_xstat NIC extended statistic (rte_eth_xstats)\n");
+    for (uint32_t i = 0; i < nb_xstats; i++) {
+        metrics_render_xstats(out, &xstats[i]);
+    }
+    
+    // Microbursts
+    metrics_printf(out, "# TYPE netgen_microbursts counter\nnetgen_microbursts_total %lu\n",
+                   (uint64_t)microburst.count);
+    
+    out += "# EOF\n";
+}
+
+// Reply to one HTTP request on 'client' (GET /metrics only)
+static void metrics_serve(int client, metrics_xstats *xstats, uint32_t nb_xstats) {
+    char request[2048];
+    ssize_t n = recv(client, request, sizeof(request) - 1, 0);
+    if (n <= 0) return;
+    request[n] = '\0';
+    
+    std::string body, head;
+    const char *status = "200 OK";
+    const char *type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    
+    if (strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?')) {
+        metrics_render(body, xstats, nb_xstats);
+    } else {
+        status = "404 Not Found";
+        type = "text/plain";
+        body = "Only /metrics is served\n";
+    }
+    
+    char hdr[256];
+    snprintf(hdr, sizeof(hdr), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+             "Connection: close\r\n\r\n", status, type, body.size());
+    control_write(client, CONTROL_FRAMING_LINE, hdr, strlen(hdr));
+    control_write(client, CONTROL_FRAMING_LINE, body.data(), body.size());
+}
+
+void* metrics_thread(__rte_unused void *arg) {
+    int sock = socket(AF_INET6, SOCK_STREAM, 0);
+    if (sock == -1) {
+        perror("metrics socket");
+        return NULL;
+    }
+    int on = 1, off = 0;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    
+    struct sockaddr_in6 addr = {};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(metrics_port);
+    
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(sock, 8) == -1) {
+        perror("metrics bind");
+        close(sock);
+        return NULL;
+    }
+    printf("OpenMetrics exporter on :%u/metrics\n", metrics_port);
+    
+    metrics_xstats xstats[2] = {{(uint16_t)tx_port, -1, NULL, NULL}, {(uint16_t)rx_port, -1, NULL, NULL}};
+    uint32_t nb_xstats = dual_port_mode ? 2 : 1;
+    
+    while (!force_quit) {
+        struct pollfd pfd = {sock, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        
+        int client = accept(sock, NULL, NULL);
+        if (client == -1) continue;
+        
+        struct timeval tv = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        metrics_serve(client, xstats, nb_xstats);
+        close(client);
+    }
+    
+    for (uint32_t i = 0; i < nb_xstats; i++) {
+        free(xstats[i].names);
+        free(xstats[i].values);
+    }
+    close(sock);
+    return NULL;
+}
+
+// ============================================================================
+// RFC 2544 ORCHESTRATOR
+// ============================================================================
+// Runs in its own thread so the control socket stays responsive. Each trial
+// zeroes the counters, sends at a fixed rate for duration_sec, drains and
+// judges loss from the per-stream RX sequence counters of profile 0.
+
+// What the control thread and a test thread share for every test: the
+// start/stop/status commands (test_runner_command) and test_sleep_ms()
+// work on this part of each test's progress struct
+struct test_progress {
+    volatile bool active;
+    volatile bool abort;
+    const char *state;          // idle, running, completed, aborted, failed
+    const char *phase;          // Procedure currently running
+};
+
+struct rfc2544_progress : test_progress {
+    double resolution_pct;
+    double max_rate_pct;
+    double current_rate_pct;
+    uint32_t trial;
+    double last_loss_pct;
+    uint32_t latency_duration_sec;
+    uint32_t b2b_trials;
+};
+
+// Per frame size results not covered by rfc2544_test_v4.results
+struct rfc2544_size_extra {
+    uint64_t latency_probes;
+    uint64_t latency_p99_ns;
+    bool latency_done;
+    double frame_loss_pct[RFC2544_LOSS_STEPS];  // At 100%, 90%, ... of line rate
+    uint8_t frame_loss_steps;
+    uint16_t frame_loss_invalid;                // Bit per step: load not fully offered
+    uint64_t b2b_frames;                        // Mean longest zero-loss burst
+    double b2b_duration_ms;
+    uint32_t b2b_trials;
+};
+
+static rfc2544_test_v4 rfc2544_test;
+static rfc2544_size_extra rfc2544_extra[RFC2544_MAX_FRAME_SIZES];
+static_assert(RTE_DIM(rfc2544_extra) == RTE_DIM(rfc2544_test_v4::results),
+              "one extra record per frame size result");
+static rfc2544_progress rfc2544_prog = {{false, false, "idle", ""}, 0, 0, 0, 0, 0, 0, 0};
+struct rfc2544_watcher {
+    int fd;                     // Client connection, owned by the watcher list
+    int framing;
+};
+
+static rfc2544_watcher rfc2544_watchers[RFC2544_MAX_WATCHERS];
+static int num_rfc2544_watchers = 0;
+static pthread_mutex_t rfc2544_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Y.1564 progress (test code follows the RFC 2544 section); the tests
+// are mutually exclusive. Phases: configuration, performance
+struct y1564_progress : test_progress {
+    bool run_config;
+    bool run_perf;
+    uint32_t step_duration_sec;
+    uint32_t perf_duration_sec;
+    double ses_flr_pct;         // Loss above this makes a second severely errored
+    int current_service;
+    uint32_t elapsed_sec;
+};
+
+static y1564_progress y1564_prog = {{false, false, "idle", ""}, false, false, 0, 0, 0, -1, 0};
+
+// RFC 2889 address caching / learning rate progress. Phases: caching,
+// learning_rate
+struct rfc2889_progress : test_progress {
+    uint32_t trial;
+    uint32_t trial_addresses;
+    double trial_rate_fps;
+    uint64_t last_flooded;
+};
+
+static rfc2889_progress rfc2889_prog = {{false, false, "idle", ""}, 0, 0, 0, 0};
+
+// Sleep in small steps so an abort request is honoured quickly
+static bool test_sleep_ms(const test_progress *prog, uint32_t ms) {
+    while (ms > 0 && !prog->abort && !force_quit) {
+        uint32_t step = RTE_MIN(ms, 100u);
+        usleep(step * 1000);
+        ms -= step;
+    }
+    return !prog->abort && !force_quit;
+}
+
+// Mark a test running and start its thread. False if the thread could not
+// be created (the test is then "failed").
+static bool test_launch(test_progress *prog, void* (*thread_main)(void*)) {
+    prog->active = true;
+    prog->abort = false;
+    prog->state = "running";
+    prog->phase = "";
+    
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, thread_main, NULL) != 0) {
+        prog->active = false;
+        prog->state = "failed";
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+// Name of the test that currently owns the engine, or NULL
+static const char* test_in_progress(void) {
+    if (rfc2544_prog.active) return "RFC 2544 test in progress";
+    if (y1564_prog.active) return "Y.1564 test in progress";
+    if (rfc2889_prog.active) return "RFC 2889 test in progress";
+    return NULL;
+}
+
+// Resolve next hops once before the first trial; every trial then reuses
+// the cached MACs
+static void test_resolve_profiles(void) {
+    const char *err = arp_resolve_profiles();
+    if (err) {
+        RTE_LOG(WARNING, USER1, "%s, sending to the configured MAC\n", err);
+    }
+}
+
+// Push one JSON line to every rfc2544_watch connection
+static void rfc2544_notify(const char *line) {
+    pthread_mutex_lock(&rfc2544_mutex);
+    for (int i = 0; i < num_rfc2544_watchers; ) {
+        if (!control_write(rfc2544_watchers[i].fd, rfc2544_watchers[i].framing, line, strlen(line))) {
+            close(rfc2544_watchers[i].fd);
+            rfc2544_watchers[i] = rfc2544_watchers[--num_rfc2544_watchers];
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&rfc2544_mutex);
+}
+
+static void rfc2544_close_watchers(void) {
+    pthread_mutex_lock(&rfc2544_mutex);
+    for (int i = 0; i < num_rfc2544_watchers; i++) {
+        close(rfc2544_watchers[i].fd);
+    }
+    num_rfc2544_watchers = 0;
+    pthread_mutex_unlock(&rfc2544_mutex);
+}
+
+// Line rate of the TX port in Mbps
+static uint64_t tx_link_mbps(void) {
+    struct rte_eth_link link = {};
+    if (rte_eth_link_get_nowait(tx_port, &link) == 0 &&
+        link.link_speed != RTE_ETH_SPEED_NUM_NONE &&
+        link.link_speed != RTE_ETH_SPEED_NUM_UNKNOWN) {
+        return link.link_speed;
+    }
+    return 10000;
+}
+
+// Maximum frame rate for a frame size (incl. CRC) at line rate
+static double line_rate_fps(uint16_t frame_size) {
+    return tx_link_mbps() * 1e6 / ((frame_size + ETHER_PREAMBLE_IFG) * 8.0);
+}
+
+// Point a profile at a frame size, rate and optional exact frame count
+static void rfc2544_setup_stream(traffic_profile *prof, uint16_t frame_size, double rate_pct,
+                                 uint64_t count) {
+    prof->packet_size = frame_size - RTE_ETHER_CRC_LEN;
+    prof->packets_to_send = count;
+    set_profile_rate_fps(prof, line_rate_fps(frame_size) * rate_pct / 100.0);
+}
+
+static double rfc2544_tx_elapsed_sec = 0;   // Last run, start to stop of TX
+
+// Run the configured profiles from zeroed counters. Continuous streams run
+// for duration_ms; exact-count streams end once every count is sent (with
+// duration_ms as the timeout). Returns false if the test was aborted.
+static bool rfc2544_run_traffic(uint32_t duration_ms) {
+    bool exact = profiles[0].packets_to_send > 0;
+    bool completed = true;
+    
+    reset_traffic_stats();
+    start_traffic();
+    
+    if (exact) {
+        for (uint32_t waited = 0; waited < duration_ms && completed; waited += 10) {
+            bool done = true;
+            for (int i = 0; i < num_profiles; i++) {
+                if (profile_packets_sent(&profiles[i]) < profiles[i].packets_to_send) done = false;
+            }
+            if (done) break;
+            completed = test_sleep_ms(&rfc2544_prog, 10);
+        }
+    } else {
+        completed = test_sleep_ms(&rfc2544_prog, duration_ms);
+    }
+    
+    rfc2544_tx_elapsed_sec = (double)(rte_get_tsc_cycles() - traffic_start_tsc) / rte_get_tsc_hz();
+    stop_traffic(RFC2544_DRAIN_MS);
+    return completed;
+}
+
+// Whether a profile really offered its load in the last run. Local TX drops
+// reuse their sequence numbers and skipped schedule debt is never sent, so
+// neither shows up as loss: a generator shortfall would otherwise pass a
+// trial at a rate that was never offered.
+static bool rfc2544_offered_ok(const traffic_profile *prof, uint64_t *offered_out) {
+    tx_counters cnt;
+    aggregate_tx_stats(prof - profiles, &cnt);
+    
+    uint64_t offered = cnt.packets_sent + cnt.packets_dropped + cnt.packets_skipped;
+    if (offered_out) *offered_out = offered;
+    return cnt.packets_sent >= offered * (1.0 - RFC2544_OFFERED_TOL);
+}
+
+// Frame loss of one profile over the last run, from its RX sequence state
+static double rfc2544_stream_loss(const traffic_profile *prof, rx_stream_state *rx,
+                                  uint64_t *received_out) {
+    aggregate_stream_stats(prof->stream_id, rx, NULL);
+    
+    uint64_t sent = profile_packets_sent(prof);
+    uint64_t received = rx->in_order + rx->out_of_order + rx->late_arrivals;
+    if (received_out) *received_out = received;
+    
+    if (sent == 0) return 100.0;
+    return sent > received ? (sent - received) * 100.0 / sent : 0.0;
+}
+
+// Record microbursts and progress of a finished trial and notify watchers
+static void rfc2544_trial_done(uint16_t frame_size, double rate_pct, uint64_t sent,
+                               uint64_t offered, uint64_t received, double loss_pct, bool valid) {
+    rfc2544_test.microburst_count += microburst.count;
+    rfc2544_test.microburst_max_duration_ns = RTE_MAX(rfc2544_test.microburst_max_duration_ns,
+                                                      microburst.max_duration_ns);
+    
+    rfc2544_prog.trial++;
+    rfc2544_prog.current_rate_pct = rate_pct;
+    rfc2544_prog.last_loss_pct = loss_pct;
+    
+    char line[512];
+    snprintf(line, sizeof(line),
+            "{\"event\":\"trial\",\"phase\":\"%s\",\"frame_size\":%u,\"trial\":%u,"
+            "\"rate_pct\":%.3f,\"packets_offered\":%lu,\"packets_sent\":%lu,"
+            "\"packets_received\":%lu,\"loss_pct\":%.6f,\"valid\":%s}\n",
+            rfc2544_prog.phase, frame_size, rfc2544_prog.trial, rate_pct,
+            offered, sent, received, loss_pct, valid ? "true" : "false");
+    rfc2544_notify(line);
+}
+
+// One timed trial of profile 0 at 'rate_pct' of line rate. Fills the loss,
+// the stream's RX summary, whether the load was really offered and the
+// measured send rate; returns false if the test was aborted.
+static bool rfc2544_trial(uint16_t frame_size, double rate_pct, uint32_t duration_sec,
+                          double *loss_pct, rx_stream_state *rx, bool *valid, double *fps) {
+    traffic_profile *prof = &profiles[0];
+    
+    rfc2544_setup_stream(prof, frame_size, rate_pct, 0);
+    if (!rfc2544_run_traffic(duration_sec * 1000)) return false;
+    
+    uint64_t received, offered;
+    uint64_t sent = profile_packets_sent(prof);
+    *valid = rfc2544_offered_ok(prof, &offered);
+    *fps = rfc2544_tx_elapsed_sec > 0 ? sent / rfc2544_tx_elapsed_sec : 0;
+    *loss_pct = rfc2544_stream_loss(prof, rx, &received);
+    rfc2544_trial_done(frame_size, rate_pct, sent, offered, received, *loss_pct, *valid);
+    return true;
+}
+
+// Binary search for the highest rate whose loss is within the threshold.
+// Returns the throughput in Mbps (frame bits), or -1 if aborted.
+double binary_search_throughput(uint16_t frame_size, double loss_threshold) {
+    rfc2544_test_v4 *test = &rfc2544_test;
+    auto *res = &test->results[test->current_size_idx];
+    double lo = 0.0, hi = rfc2544_prog.max_rate_pct;
+    double rate = hi;
+    double loss, fps;
+    bool valid;
+    rx_stream_state rx;
+    
+    res->frame_size = frame_size;
+    res->passed = false;
+    rfc2544_prog.phase = "throughput";
+    
+    while (true) {
+        if (!rfc2544_trial(frame_size, rate, test->duration_sec, &loss, &rx, &valid, &fps)) return -1;
+        
+        // A trial the generator could not offer in full does not pass
+        if (valid && loss <= loss_threshold) {
+            lo = rate;
+            res->passed = true;
+            res->loss_pct = loss;
+            res->max_throughput_fps = fps;
+            res->max_throughput_mbps = res->max_throughput_fps * frame_size * 8 / 1e6;
+            res->min_latency_ns = rx.latency_min_ns;
+            res->max_latency_ns = rx.latency_max_ns;
+            res->avg_latency_ns = rx.latency_count ? rx.latency_sum_ns / rx.latency_count : 0;
+            res->jitter_ns = rx.jitter_q4 >> 4;
+        } else {
+            hi = rate;
+        }
+        
+        if (hi - lo <= rfc2544_prog.resolution_pct) break;
+        rate = (lo + hi) / 2.0;
+    }
+    
+    return res->passed ? res->max_throughput_mbps : 0.0;
+}
+
+// RFC 2544 26.2: latency at the throughput rate, measured on a low-rate
+// stream of tagged probe frames (own stream id) running alongside profile 0
+static bool rfc2544_latency(uint16_t frame_size, uint8_t idx) {
+    auto *res = &rfc2544_test.results[idx];
+    rfc2544_size_extra *extra = &rfc2544_extra[idx];
+    traffic_profile *prof = &profiles[0];
+    traffic_profile *probe = &profiles[1];
+    
+    if (!res->passed) return true;
+    rfc2544_prog.phase = "latency";
+    
+    double line_fps = line_rate_fps(frame_size);
+    double probe_pct = RTE_MIN(RFC2544_PROBE_PPS * 100.0 / line_fps, res->max_throughput_fps * 100.0 / line_fps / 2);
+    double rate_pct = res->max_throughput_fps * 100.0 / line_fps - probe_pct;
+    
+    *probe = *prof;
+    snprintf(probe->name, sizeof(probe->name), "rfc2544_probe");
+    probe->stream_id = RFC2544_PROBE_STREAM;
+    probe->src_port_min = probe->src_port_max = prof->src_port_min;
+    probe->sequence_num = 0;
+    
+    rfc2544_setup_stream(prof, frame_size, rate_pct, 0);
+    rfc2544_setup_stream(probe, frame_size, probe_pct, 0);
+    num_profiles = 2;
+    bool completed = rfc2544_run_traffic(rfc2544_prog.latency_duration_sec * 1000);
+    num_profiles = 1;
+    if (!completed) return false;
+    
+    rx_stream_state rx;
+    uint64_t hist[LAT_HIST_BUCKETS];
+    uint64_t received;
+    double loss = rfc2544_stream_loss(probe, &rx, &received);
+    aggregate_stream_stats(probe->stream_id, &rx, hist);
+    
+    res->min_latency_ns = rx.latency_min_ns;
+    res->max_latency_ns = rx.latency_max_ns;
+    res->avg_latency_ns = rx.latency_count ? rx.latency_sum_ns / rx.latency_count : 0;
+    res->jitter_ns = rx.jitter_q4 >> 4;
+    extra->latency_probes = rx.latency_count;
+    extra->latency_p99_ns = lat_hist_quantile(hist, rx.latency_count, 990);
+    extra->latency_done = true;
+    
+    uint64_t offered;
+    bool valid = rfc2544_offered_ok(prof, NULL) && rfc2544_offered_ok(probe, &offered);
+    rfc2544_trial_done(frame_size, rate_pct + probe_pct, profile_packets_sent(probe),
+                       offered, received, loss, valid);
+    return true;
+}
+
+// RFC 2544 26.3: frame loss rate from 100% down in 10% steps, until two
+// successive steps are loss free
+static bool rfc2544_frame_loss(uint16_t frame_size, uint8_t idx) {
+    rfc2544_size_extra *extra = &rfc2544_extra[idx];
+    uint32_t clean_steps = 0;
+    double loss, fps;
+    bool valid;
+    rx_stream_state rx;
+    
+    rfc2544_prog.phase = "frame_loss";
+    extra->frame_loss_steps = 0;
+    extra->frame_loss_invalid = 0;
+    
+    for (uint8_t step = 0; step < RFC2544_LOSS_STEPS && clean_steps < 2; step++) {
+        double rate_pct = 100.0 - step * (100.0 / RFC2544_LOSS_STEPS);
+        if (!rfc2544_trial(frame_size, rate_pct, rfc2544_test.duration_sec, &loss, &rx, &valid, &fps)) {
+            return false;
+        }
+        
+        extra->frame_loss_pct[step] = loss;
+        extra->frame_loss_steps = step + 1;
+        if (!valid) extra->frame_loss_invalid |= 1u << step;
+        clean_steps = valid && loss == 0.0 ? clean_steps + 1 : 0;
+    }
+    return true;
+}
+
+// RFC 2544 26.4: longest burst of exactly N frames at line rate with zero
+// loss, binary searched and averaged over b2b_trials repetitions
+static bool rfc2544_back_to_back(uint16_t frame_size, uint8_t idx) {
+    rfc2544_size_extra *extra = &rfc2544_extra[idx];
+    traffic_profile *prof = &profiles[0];
+    double line_fps = line_rate_fps(frame_size);
+    uint64_t max_frames = (uint64_t)(line_fps * RFC2544_B2B_MAX_SEC);
+    uint64_t resolution = RTE_MAX(max_frames / 1000, (uint64_t)1);
+    uint64_t total = 0;
+    rx_stream_state rx;
+    
+    rfc2544_prog.phase = "back_to_back";
+    
+    for (uint32_t t = 0; t < rfc2544_prog.b2b_trials; t++) {
+        uint64_t lo = 0, hi = max_frames, frames = max_frames;
+        
+        while (true) {
+            rfc2544_setup_stream(prof, frame_size, 100.0, frames);
+            if (!rfc2544_run_traffic(RFC2544_B2B_MAX_SEC * 4000)) return false;
+            
+            // The burst must be offered in full and back to back: local
+            // drops or skipped schedule debt fail it like loss would
+            uint64_t received, offered;
+            uint64_t sent = profile_packets_sent(prof);
+            bool valid = rfc2544_offered_ok(prof, &offered) && sent == frames;
+            double loss = rfc2544_stream_loss(prof, &rx, &received);
+            rfc2544_trial_done(frame_size, 100.0, sent, offered, received, loss, valid);
+            
+            if (valid && received >= frames) {
+                lo = frames;
+            } else {
+                hi = frames;
+            }
+            
+            if (hi - lo <= resolution) break;
+            frames = lo + (hi - lo) / 2;
+        }
+        
+        total += lo;
+        extra->b2b_trials = t + 1;
+        extra->b2b_frames = total / extra->b2b_trials;
+        extra->b2b_duration_ms = extra->b2b_frames * 1000.0 / line_fps;
+    }
+    
+    prof->packets_to_send = 0;
+    return true;
+}
+
+// Per frame size result line for rfc2544_watch
+static void rfc2544_notify_result(uint8_t idx) {
+    const auto *res = &rfc2544_test.results[idx];
+    const rfc2544_size_extra *extra = &rfc2544_extra[idx];
+    char line[512];
+    
+    snprintf(line, sizeof(line),
+            "{\"event\":\"result\",\"frame_size\":%u,\"passed\":%s,"
+            "\"throughput_fps\":%.0f,\"throughput_mbps\":%.2f,\"loss_pct\":%.6f,"
+            "\"latency_avg_ns\":%lu,\"back_to_back_frames\":%lu}\n",
+            res->frame_size, res->passed ? "true" : "false",
+            res->max_throughput_fps, res->max_throughput_mbps, res->loss_pct,
+            res->avg_latency_ns, extra->b2b_frames);
+    rfc2544_notify(line);
+}
+
+int run_rfc2544_multisize(struct rfc2544_test_v4 *test) {
+    for (uint8_t i = 0; i < test->num_frame_sizes && i < RTE_DIM(rfc2544_extra); i++) {
+        uint16_t frame_size = test->frame_sizes[i];
+        test->current_size_idx = i;
+        test->results[i].frame_size = frame_size;
+        
+        // Latency is measured at the throughput rate, so it implies throughput
+        if (test->test_type & (RFC2544_TEST_THROUGHPUT | RFC2544_TEST_LATENCY)) {
+            if (binary_search_throughput(frame_size, test->loss_threshold_pct) < 0) return -1;
+        }
+        if ((test->test_type & RFC2544_TEST_LATENCY) && !rfc2544_latency(frame_size, i)) return -1;
+        if ((test->test_type & RFC2544_TEST_FRAME_LOSS) && !rfc2544_frame_loss(frame_size, i)) return -1;
+        if ((test->test_type & RFC2544_TEST_BACK_TO_BACK) && !rfc2544_back_to_back(frame_size, i)) return -1;
+        
+        rfc2544_notify_result(i);
+    }
+    return 0;
+}
+
+static void* rfc2544_thread(__rte_unused void *arg) {
+    // Run on profile 0 (plus the latency probe in slot 1), restored afterwards
+    if (num_profiles == 0) {
+        create_default_profile();
+    }
+    test_resolve_profiles();
+    traffic_profile saved[2] = {profiles[0], profiles[1]};
+    int saved_num = num_profiles;
+    num_profiles = 1;
+    
+    int ret = run_rfc2544_multisize(&rfc2544_test);
+    
+    uint32_t seq = profiles[0].sequence_num;
+    profiles[0] = saved[0];
+    profiles[0].sequence_num = seq;
+    profiles[1] = saved[1];
+    num_profiles = saved_num;
+    
+    rfc2544_test.running = false;
+    rfc2544_prog.state = ret == 0 ? "completed" : "aborted";
+    
+    char line[128];
+    snprintf(line, sizeof(line), "{\"event\":\"done\",\"state\":\"%s\"}\n", rfc2544_prog.state);
+    rfc2544_notify(line);
+    rfc2544_close_watchers();
+    
+    rfc2544_prog.active = false;
+    return NULL;
+}
+
+// Test names a "tests" array may select, and the flag each one sets
+struct test_selection {
+    const char *name;
+    uint32_t flag;
+};
+
+// OR the flags of the names in a "tests" array into *flags. Returns an
+// error message or NULL; an empty selection is left to the caller.
+static const char* test_parse_selection(struct json_object *val, const test_selection *names,
+                                        size_t num_names, uint32_t *flags, const char *unknown) {
+    if (!json_object_is_type(val, json_type_array)) return "tests must be an array of test names";
+    
+    *flags = 0;
+    for (size_t i = 0; i < json_object_array_length(val); i++) {
+        struct json_object *elem = json_object_array_get_idx(val, i);
+        if (!json_object_is_type(elem, json_type_string)) return "tests must be an array of test names";
+        
+        const char *name = json_object_get_string(elem);
+        size_t k = 0;
+        while (k < num_names && strcmp(name, names[k].name) != 0) k++;
+        if (k == num_names) return unknown;
+        *flags |= names[k].flag;
+    }
+    return NULL;
+}
+
+// Parse an rfc2544_start request and launch the orchestrator thread
+static const char* rfc2544_start(struct json_object *root) {
+    if (test_in_progress()) return test_in_progress();
+    if (running) return "Traffic is running, stop it first";
+    if (num_rx_lcores == 0) return "RFC 2544 needs an RX port and RX lcore";
+    
+    static const uint16_t default_sizes[] = {64, 128, 256, 512, 1024, 1280, 1518};
+    rfc2544_test_v4 *test = &rfc2544_test;
+    memset(test, 0, sizeof(*test));
+    memset(rfc2544_extra, 0, sizeof(rfc2544_extra));
+    test->test_type = RFC2544_TEST_THROUGHPUT;
+    test->duration_sec = 60;
+    test->loss_threshold_pct = 0.0;
+    rfc2544_prog.resolution_pct = 0.5;
+    rfc2544_prog.max_rate_pct = 100.0;
+    rfc2544_prog.latency_duration_sec = 120;
+    rfc2544_prog.b2b_trials = 5;
+    
+    struct json_object *val;
+    if (json_object_object_get_ex(root, "tests", &val)) {
+        static const test_selection tests[] = {
+            {"throughput", RFC2544_TEST_THROUGHPUT},
+            {"latency", RFC2544_TEST_LATENCY},
+            {"frame_loss", RFC2544_TEST_FRAME_LOSS},
+            {"back_to_back", RFC2544_TEST_BACK_TO_BACK},
+        };
+        uint32_t selected;
+        const char *err = test_parse_selection(val, tests, RTE_DIM(tests), &selected,
+                                               "Unknown RFC 2544 test");
+        if (err) return err;
+        if (selected == 0) return "No RFC 2544 tests selected";
+        test->test_type = selected;
+    }
+    if (json_object_object_get_ex(root, "frame_sizes", &val)) {
+        if (!json_object_is_type(val, json_type_array)) return "frame_sizes must be an array";
+        size_t n = RTE_MIN(json_object_array_length(val), RTE_DIM(test->frame_sizes));
+        for (size_t i = 0; i < n; i++) {
+            struct json_object *elem = json_object_array_get_idx(val, i);
+            if (!json_object_is_type(elem, json_type_int)) return "Invalid frame size";
+            int size = json_object_get_int(elem);
+            if (size < RTE_ETHER_MIN_LEN || size > RTE_ETHER_MAX_LEN) return "Invalid frame size";
+            test->frame_sizes[test->num_frame_sizes++] = size;
+        }
+    } else {
+        for (size_t i = 0; i < RTE_DIM(default_sizes); i++) {
+            test->frame_sizes[test->num_frame_sizes++] = default_sizes[i];
+        }
+    }
+    if (test->num_frame_sizes == 0) return "No frame sizes";
+    
+    if (json_object_object_get_ex(root, "duration_sec", &val)) {
+        test->duration_sec = RTE_MAX(json_object_get_int(val), 1);
+    }
+    if (json_object_object_get_ex(root, "loss_threshold_pct", &val)) {
+        test->loss_threshold_pct = json_object_get_double(val);
+    }
+    if (json_object_object_get_ex(root, "resolution_pct", &val)) {
+        rfc2544_prog.resolution_pct = RTE_MAX(json_object_get_double(val), 0.001);
+    }
+    if (json_object_object_get_ex(root, "max_rate_pct", &val)) {
+        rfc2544_prog.max_rate_pct = RTE_MIN(RTE_MAX(json_object_get_double(val), 0.01), 100.0);
+    }
+    if (json_object_object_get_ex(root, "latency_duration_sec", &val)) {
+        rfc2544_prog.latency_duration_sec = RTE_MAX(json_object_get_int(val), 1);
+    }
+    if (json_object_object_get_ex(root, "back_to_back_trials", &val)) {
+        rfc2544_prog.b2b_trials = RTE_MAX(json_object_get_int(val), 1);
+    }
+    
+    test->running = true;
+    rfc2544_prog.trial = 0;
+    rfc2544_prog.current_rate_pct = 0;
+    rfc2544_prog.last_loss_pct = 0;
+    
+    if (!test_launch(&rfc2544_prog, rfc2544_thread)) {
+        test->running = false;
+        return "Failed to start RFC 2544 thread";
+    }
+    return NULL;
+}
+
+// Progress and per-size results as JSON
+static void rfc2544_format_status(char *buf, size_t size) {
+    const rfc2544_test_v4 *test = &rfc2544_test;
+    int written = snprintf(buf, size,
+            "{\"status\":\"success\",\"data\":{\"state\":\"%s\",\"phase\":\"%s\","
+            "\"frame_size_index\":%u,\"trial\":%u,\"current_rate_pct\":%.3f,"
+            "\"last_loss_pct\":%.6f,\"duration_sec\":%u,\"loss_threshold_pct\":%.6f,"
+            "\"microburst_count\":%u,\"microburst_max_duration_ns\":%lu,\"results\":[",
+            rfc2544_prog.state, rfc2544_prog.phase, test->current_size_idx, rfc2544_prog.trial,
+            rfc2544_prog.current_rate_pct, rfc2544_prog.last_loss_pct,
+            test->duration_sec, test->loss_threshold_pct,
+            test->microburst_count, test->microburst_max_duration_ns);
+    
+    for (uint8_t i = 0; i < test->num_frame_sizes && i < RTE_DIM(rfc2544_extra) && (size_t)written < size; i++) {
+        const auto *res = &test->results[i];
+        const rfc2544_size_extra *extra = &rfc2544_extra[i];
+        if (res->frame_size == 0) continue;
+        
+        written += snprintf(buf + written, size - written,
+                "%s{\"frame_size\":%u,"
+                "\"throughput\":{\"passed\":%s,\"fps\":%.0f,\"mbps\":%.2f,\"loss_pct\":%.6f},"
+                "\"latency\":{\"measured\":%s,\"probes\":%lu,\"min_ns\":%lu,\"avg_ns\":%lu,"
+                "\"max_ns\":%lu,\"p99_ns\":%lu,\"jitter_ns\":%lu},"
+                "\"frame_loss\":[",
+                i > 0 ? "," : "", res->frame_size,
+                res->passed ? "true" : "false", res->max_throughput_fps,
+                res->max_throughput_mbps, res->loss_pct,
+                extra->latency_done ? "true" : "false", extra->latency_probes,
+                res->min_latency_ns, res->avg_latency_ns, res->max_latency_ns,
+                extra->latency_p99_ns, res->jitter_ns);
+        
+        for (uint8_t step = 0; step < extra->frame_loss_steps && (size_t)written < size; step++) {
+            written += snprintf(buf + written, size - written,
+                    "%s{\"rate_pct\":%.0f,\"loss_pct\":%.6f,\"valid\":%s}", step > 0 ? "," : "",
+                    100.0 - step * (100.0 / RFC2544_LOSS_STEPS), extra->frame_loss_pct[step],
+                    extra->frame_loss_invalid & (1u << step) ? "false" : "true");
+        }
+        
+        if ((size_t)written < size) {
+            written += snprintf(buf + written, size - written,
+                    "],\"back_to_back\":{\"trials\":%u,\"frames\":%lu,\"duration_ms\":%.3f}}",
+                    extra->b2b_trials, extra->b2b_frames, extra->b2b_duration_ms);
+        }
+    }
+    
+    if ((size_t)written < size) snprintf(buf + written, size - written, "]}}\n");
+}
+
+// ITU-T Y.1564 service activation. Each service is a profile paced at its
+// own CIR/EIR. The service configuration test step-loads one service at a
+// time; the performance test runs every service at CIR concurrently and
+// tracks availability in one second intervals.
+enum y1564_step_type {
+    Y1564_STEP_CIR = 0,
+    Y1564_STEP_EIR,
+    Y1564_STEP_POLICING
+};
+
+struct y1564_measurement {
+    uint8_t type;               // y1564_step_type
+    double rate_mbps;           // Offered information rate
+    double rx_mbps;             // Received information rate
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    double flr_pct;
+    uint64_t ftd_avg_ns;
+    uint64_t ftd_max_ns;
+    uint64_t fdv_ns;            // p99 delay - min delay
+    bool passed;
+};
+
+struct y1564_service {
+    traffic_profile prof;       // Template; rate set per step
+    uint16_t frame_size;        // Including CRC
+    double cir_mbps;
+    double eir_mbps;
+    bool policing;
+    
+    // Service acceptance criteria
+    double sac_flr_pct;
+    uint64_t sac_ftd_ns;
+    uint64_t sac_fdv_ns;
+    double sac_avail_pct;
+    
+    y1564_measurement steps[Y1564_MAX_STEPS];
+    uint8_t num_steps;
+    bool config_passed;
+    
+    y1564_measurement perf;
+    uint64_t perf_seconds;
+    uint64_t unavail_seconds;
+    bool perf_passed;
+    
+    // Availability state during the performance test
+    bool available;
+    uint32_t run_seconds;       // Consecutive SES (or non-SES while unavailable)
+    uint64_t last_sent;
+    uint64_t last_received;
+};
+
+static y1564_service y1564_services[Y1564_MAX_SERVICES];
+static int num_y1564_services = 0;
+static traffic_profile y1564_saved_profiles[MAX_PROFILES];
+
+// Pace a service's profile at an information rate (frame bits incl. CRC)
+static void y1564_set_rate(y1564_service *svc, traffic_profile *prof, double mbps) {
+    prof->packet_size = svc->frame_size - RTE_ETHER_CRC_LEN;
+    set_profile_rate_fps(prof, mbps * 1e6 / (svc->frame_size * 8.0));
+}
+
+// Fill a measurement from a profile's TX counters and its RX stream
+static void y1564_measure(const y1564_service *svc, const traffic_profile *prof,
+                          uint32_t duration_sec, y1564_measurement *m) {
+    rx_stream_state rx;
+    uint64_t hist[LAT_HIST_BUCKETS];
+    aggregate_stream_stats(prof->stream_id, &rx, hist);
+    
+    uint64_t received = rx.in_order + rx.out_of_order + rx.late_arrivals;
+    uint64_t p99 = lat_hist_quantile(hist, rx.latency_count, 990);
+    
+    m->packets_sent = profile_packets_sent(prof);
+    m->packets_received = received;
+    m->flr_pct = m->packets_sent > received ?
+                 (m->packets_sent - received) * 100.0 / m->packets_sent : 0.0;
+    m->rx_mbps = received * svc->frame_size * 8.0 / (duration_sec * 1e6);
+    m->ftd_avg_ns = rx.latency_count ? rx.latency_sum_ns / rx.latency_count : 0;
+    m->ftd_max_ns = rx.latency_max_ns;
+    m->fdv_ns = p99 > rx.latency_min_ns ? p99 - rx.latency_min_ns : 0;
+}
+
+// SAC check of one measurement. Within CIR all criteria apply; above CIR
+// only the committed part must arrive, and a policing step passes when the
+// DUT limits the service to CIR+EIR.
+static bool y1564_step_passed(const y1564_service *svc, const y1564_measurement *m) {
+    double cir_floor = RTE_MIN(svc->cir_mbps, m->rate_mbps) * (1.0 - svc->sac_flr_pct / 100.0);
+    
+    switch (m->type) {
+    case Y1564_STEP_EIR:
+        return m->rx_mbps >= cir_floor;
+    case Y1564_STEP_POLICING:
+        return m->rx_mbps >= cir_floor && m->rx_mbps <= svc->cir_mbps + svc->eir_mbps;
+    default:
+        return m->flr_pct <= svc->sac_flr_pct &&
+               m->ftd_avg_ns <= svc->sac_ftd_ns &&
+               m->fdv_ns <= svc->sac_fdv_ns;
+    }
+}
+
+// Run the configured profiles for 'seconds', calling 'tick' once a second.
+// Returns false if the test was aborted.
+static bool y1564_run_traffic(uint32_t seconds, void (*tick)(void)) {
+    bool completed = true;
+    
+    reset_traffic_stats();
+    start_traffic();
+    
+    for (uint32_t t = 0; t < seconds && completed; t++) {
+        completed = test_sleep_ms(&y1564_prog, 1000);
+        y1564_prog.elapsed_sec = t + 1;
+        if (completed && tick) tick();
+    }
+    
+    stop_traffic(RFC2544_DRAIN_MS);
+    return completed;
+}
+
+// Service configuration test: step-load one service on profile 0
+static bool y1564_configuration(y1564_service *svc) {
+    static const double cir_steps[] = {25.0, 50.0, 75.0, 100.0};
+    traffic_profile *prof = &profiles[0];
+    
+    svc->num_steps = 0;
+    for (size_t i = 0; i < RTE_DIM(cir_steps); i++) {
+        svc->steps[svc->num_steps].type = Y1564_STEP_CIR;
+        svc->steps[svc->num_steps++].rate_mbps = svc->cir_mbps * cir_steps[i] / 100.0;
+    }
+    if (svc->eir_mbps > 0) {
+        svc->steps[svc->num_steps].type = Y1564_STEP_EIR;
+        svc->steps[svc->num_steps++].rate_mbps = svc->cir_mbps + svc->eir_mbps;
+    }
+    if (svc->policing) {
+        // Y.1564 8.1.2: overshoot EIR by 25% (or CIR when there is no EIR)
+        svc->steps[svc->num_steps].type = Y1564_STEP_POLICING;
+        svc->steps[svc->num_steps++].rate_mbps = svc->eir_mbps > 0 ?
+                svc->cir_mbps + svc->eir_mbps * 1.25 : svc->cir_mbps * 1.25;
+    }
+    
+    svc->config_passed = true;
+    for (uint8_t i = 0; i < svc->num_steps; i++) {
+        y1564_measurement *m = &svc->steps[i];
+        
+        *prof = svc->prof;
+        y1564_set_rate(svc, prof, m->rate_mbps);
+        num_profiles = 1;
+        
+        if (!y1564_run_traffic(y1564_prog.step_duration_sec, NULL)) return false;
+        svc->prof.sequence_num = prof->sequence_num;
+        
+        y1564_measure(svc, prof, y1564_prog.step_duration_sec, m);
+        m->passed = y1564_step_passed(svc, m);
+        svc->config_passed &= m->passed;
+        
+        RTE_LOG(INFO, USER1, "Y.1564 %s step %u: %.2f Mbps offered, %.2f received, FLR %.4f%%, %s\n",
+                svc->prof.name, i + 1, m->rate_mbps, m->rx_mbps, m->flr_pct,
+                m->passed ? "pass" : "fail");
+    }
+    return true;
+}
+
+// Per second availability of every service (performance test).
+// Y.1563: a second is severely errored when its FLR exceeds ses_flr_pct;
+// 10 consecutive SES start unavailable time, 10 non-SES end it, and both
+// transitions apply from the first of those 10 seconds.
+static void y1564_availability_tick(void) {
+    for (int i = 0; i < num_y1564_services; i++) {
+        y1564_service *svc = &y1564_services[i];
+        traffic_profile *prof = &profiles[i];
+        rx_stream_state rx;
+        
+        aggregate_stream_stats(prof->stream_id, &rx, NULL);
+        uint64_t sent = profile_packets_sent(prof);
+        uint64_t received = rx.in_order + rx.out_of_order + rx.late_arrivals;
+        uint64_t sent_delta = sent - svc->last_sent;
+        uint64_t received_delta = received - svc->last_received;
+        svc->last_sent = sent;
+        svc->last_received = received;
+        
+        bool ses = sent_delta > 0 && sent_delta > received_delta &&
+                   (sent_delta - received_delta) * 100.0 / sent_delta > y1564_prog.ses_flr_pct;
+        svc->perf_seconds++;
+        
+        if (svc->available) {
+            svc->run_seconds = ses ? svc->run_seconds + 1 : 0;
+            if (svc->run_seconds == Y1564_AVAIL_WINDOW) {
+                svc->available = false;
+                svc->unavail_seconds += Y1564_AVAIL_WINDOW;
+                svc->run_seconds = 0;
+            }
+        } else {
+            svc->unavail_seconds++;
+            svc->run_seconds = ses ? 0 : svc->run_seconds + 1;
+            if (svc->run_seconds == Y1564_AVAIL_WINDOW) {
+                svc->available = true;
+                svc->unavail_seconds -= Y1564_AVAIL_WINDOW;
+                svc->run_seconds = 0;
+            }
+        }
+    }
+}
+
+// Service performance test: all services at CIR at the same time
+static bool y1564_performance(void) {
+    for (int i = 0; i < num_y1564_services; i++) {
+        y1564_service *svc = &y1564_services[i];
+        
+        profiles[i] = svc->prof;
+        y1564_set_rate(svc, &profiles[i], svc->cir_mbps);
+        svc->perf.type = Y1564_STEP_CIR;
+        svc->perf.rate_mbps = svc->cir_mbps;
+        svc->perf_seconds = 0;
+        svc->unavail_seconds = 0;
+        svc->available = true;
+        svc->run_seconds = 0;
+        svc->last_sent = 0;
+        svc->last_received = 0;
+    }
+    num_profiles = num_y1564_services;
+    
+    if (!y1564_run_traffic(y1564_prog.perf_duration_sec, y1564_availability_tick)) return false;
+    
+    for (int i = 0; i < num_y1564_services; i++) {
+        y1564_service *svc = &y1564_services[i];
+        double avail_pct = svc->perf_seconds ?
+                (svc->perf_seconds - svc->unavail_seconds) * 100.0 / svc->perf_seconds : 0.0;
+        
+        svc->prof.sequence_num = profiles[i].sequence_num;
+        y1564_measure(svc, &profiles[i], y1564_prog.perf_duration_sec, &svc->perf);
+        svc->perf.passed = y1564_step_passed(svc, &svc->perf);
+        svc->perf_passed = svc->perf.passed && avail_pct >= svc->sac_avail_pct;
+        
+        RTE_LOG(INFO, USER1, "Y.1564 %s performance: FLR %.4f%%, FTD %lu ns, FDV %lu ns, AVAIL %.3f%%, %s\n",
+                svc->prof.name, svc->perf.flr_pct, svc->perf.ftd_avg_ns, svc->perf.fdv_ns,
+                avail_pct, svc->perf_passed ? "pass" : "fail");
+    }
+    return true;
+}
+
+static void* y1564_thread(__rte_unused void *arg) {
+    test_resolve_profiles();
+    int saved_num = num_profiles;
+    memcpy(y1564_saved_profiles, profiles, sizeof(profiles));
+    bool completed = true;
+    
+    if (y1564_prog.run_config) {
+        y1564_prog.phase = "configuration";
+        for (int i = 0; i < num_y1564_services && completed; i++) {
+            y1564_prog.current_service = i;
+            completed = y1564_configuration(&y1564_services[i]);
+        }
+    }
+    if (y1564_prog.run_perf && completed) {
+        y1564_prog.phase = "performance";
+        y1564_prog.current_service = -1;
+        completed = y1564_performance();
+    }
+    
+    memcpy(profiles, y1564_saved_profiles, sizeof(profiles));
+    num_profiles = saved_num;
+    
+    y1564_prog.state = completed ? "completed" : "aborted";
+    y1564_prog.active = false;
+    return NULL;
+}
+
+// Parse one service definition; the default profile provides the template
+static const char* y1564_parse_service(struct json_object *obj, int index, y1564_service *svc) {
+    struct json_object *val, *sac;
+    
+    memset(svc, 0, sizeof(*svc));
+    svc->prof = y1564_saved_profiles[0];
+    svc->prof.stream_id = index + 1;
+    svc->prof.sequence_num = 0;
+    svc->prof.packets_to_send = 0;
+    snprintf(svc->prof.name, sizeof(svc->prof.name), "service%d", index + 1);
+    svc->frame_size = 512;
+    svc->sac_flr_pct = 0.0;
+    svc->sac_ftd_ns = 10000000ULL;      // 10 ms
+    svc->sac_fdv_ns = 2000000ULL;       // 2 ms
+    svc->sac_avail_pct = 99.9;
+    
+    if (!json_object_is_type(obj, json_type_object)) return "Each service must be an object";
+    if (json_object_object_get_ex(obj, "name", &val)) {
+        if (!json_object_is_type(val, json_type_string)) return "Invalid service name";
+        snprintf(svc->prof.name, sizeof(svc->prof.name), "%s", json_object_get_string(val));
+    }
+    if (json_object_object_get_ex(obj, "dst_ip", &val)) {
+        struct in_addr addr;
+        if (!json_object_is_type(val, json_type_string) ||
+            inet_pton(AF_INET, json_object_get_string(val), &addr) != 1) return "Invalid dst_ip";
+        svc->prof.dst_ip = ntohl(addr.s_addr);
+    }
+    if (json_object_object_get_ex(obj, "dst_port", &val)) {
+        svc->prof.dst_port = json_object_get_int(val);
+    }
+    if (json_object_object_get_ex(obj, "vlan_id", &val)) {
+        svc->prof.vlan_id = json_object_get_int(val) & 0xFFF;
+        svc->prof.vlan_enabled = svc->prof.vlan_id != 0;
+    }
+    if (json_object_object_get_ex(obj, "dscp", &val)) {
+        svc->prof.dscp = json_object_get_int(val) & 0x3F;
+    }
+    if (json_object_object_get_ex(obj, "frame_size", &val)) {
+        int size = json_object_get_int(val);
+        if (size < RTE_ETHER_MIN_LEN || size > RTE_ETHER_MAX_LEN) return "Invalid frame size";
+        svc->frame_size = size;
+    }
+    if (!json_object_object_get_ex(obj, "cir_mbps", &val) || json_object_get_double(val) <= 0) {
+        return "Service needs a positive cir_mbps";
+    }
+    svc->cir_mbps = json_object_get_double(val);
+    if (json_object_object_get_ex(obj, "eir_mbps", &val)) {
+        svc->eir_mbps = RTE_MAX(json_object_get_double(val), 0.0);
+    }
+    if (json_object_object_get_ex(obj, "policing", &val)) {
+        svc->policing = json_object_get_boolean(val);
+    }
+    
+    if (json_object_object_get_ex(obj, "sac", &sac)) {
+        if (json_object_object_get_ex(sac, "flr_pct", &val)) {
+            svc->sac_flr_pct = json_object_get_double(val);
+        }
+        if (json_object_object_get_ex(sac, "ftd_ms", &val)) {
+            svc->sac_ftd_ns = (uint64_t)(json_object_get_double(val) * 1e6);
+        }
+        if (json_object_object_get_ex(sac, "fdv_ms", &val)) {
+            svc->sac_fdv_ns = (uint64_t)(json_object_get_double(val) * 1e6);
+        }
+        if (json_object_object_get_ex(sac, "availability_pct", &val)) {
+            svc->sac_avail_pct = json_object_get_double(val);
+        }
+    }
+    return NULL;
+}
+
+// Parse a y1564_start request and launch the test thread
+static const char* y1564_start(struct json_object *root) {
+    if (test_in_progress()) return test_in_progress();
+    if (running) return "Traffic is running, stop it first";
+    if (num_rx_lcores == 0) return "Y.1564 needs an RX port and RX lcore";
+    
+    struct json_object *services, *val;
+    if (!json_object_object_get_ex(root, "services", &services)) return "No services";
+    if (!json_object_is_type(services, json_type_array)) return "services must be an array";
+    
+    int n = json_object_array_length(services);
+    if (n == 0 || n > Y1564_MAX_SERVICES) return "Need 1-16 services";
+    
+    if (num_profiles == 0) {
+        create_default_profile();
+    }
+    y1564_saved_profiles[0] = profiles[0];
+    
+    double total_cir = 0;
+    for (int i = 0; i < n; i++) {
+        const char *err = y1564_parse_service(json_object_array_get_idx(services, i), i,
+                                              &y1564_services[i]);
+        if (err) return err;
+        total_cir += y1564_services[i].cir_mbps;
+    }
+    if (total_cir > tx_link_mbps()) return "Total CIR exceeds the TX link rate";
+    num_y1564_services = n;
+    
+    y1564_prog.run_config = true;
+    y1564_prog.run_perf = true;
+    y1564_prog.step_duration_sec = 60;
+    y1564_prog.perf_duration_sec = 15 * 60;
+    y1564_prog.ses_flr_pct = 50.0;
+    
+    if (json_object_object_get_ex(root, "tests", &val)) {
+        static const test_selection tests[] = {
+            {"configuration", 1},
+            {"performance", 2},
+        };
+        uint32_t selected;
+        const char *err = test_parse_selection(val, tests, RTE_DIM(tests), &selected,
+                                               "Unknown Y.1564 test");
+        if (err) return err;
+        if (selected == 0) return "No Y.1564 tests selected";
+        y1564_prog.run_config = selected & 1;
+        y1564_prog.run_perf = selected & 2;
+    }
+    if (json_object_object_get_ex(root, "step_duration_sec", &val)) {
+        y1564_prog.step_duration_sec = RTE_MAX(json_object_get_int(val), 1);
+    }
+    if (json_object_object_get_ex(root, "performance_duration_sec", &val)) {
+        y1564_prog.perf_duration_sec = RTE_MAX(json_object_get_int(val), Y1564_AVAIL_WINDOW);
+    }
+    if (json_object_object_get_ex(root, "ses_flr_pct", &val)) {
+        y1564_prog.ses_flr_pct = json_object_get_double(val);
+    }
+    
+    y1564_prog.current_service = -1;
+    y1564_prog.elapsed_sec = 0;
+    
+    return test_launch(&y1564_prog, y1564_thread) ? NULL : "Failed to start Y.1564 thread";
+}
+
+static int y1564_format_measurement(char *buf, size_t size, const y1564_measurement *m) {
+    static const char *types[] = {"cir", "eir", "policing"};
+    return snprintf(buf, size,
+            "{\"type\":\"%s\",\"rate_mbps\":%.3f,\"rx_mbps\":%.3f,\"packets_sent\":%lu,"
+            "\"packets_received\":%lu,\"flr_pct\":%.6f,\"ftd_avg_ns\":%lu,\"ftd_max_ns\":%lu,"
+            "\"fdv_ns\":%lu,\"passed\":%s}",
+            types[m->type], m->rate_mbps, m->rx_mbps, m->packets_sent, m->packets_received,
+            m->flr_pct, m->ftd_avg_ns, m->ftd_max_ns, m->fdv_ns, m->passed ? "true" : "false");
+}
+
+// Progress and per-service results as JSON
+static void y1564_format_status(char *buf, size_t size) {
+    int written = snprintf(buf, size,
+            "{\"status\":\"success\",\"data\":{\"state\":\"%s\",\"phase\":\"%s\","
+            "\"current_service\":%d,\"elapsed_sec\":%u,\"step_duration_sec\":%u,"
+            "\"performance_duration_sec\":%u,\"services\":[",
+            y1564_prog.state, y1564_prog.phase, y1564_prog.current_service,
+            y1564_prog.elapsed_sec, y1564_prog.step_duration_sec, y1564_prog.perf_duration_sec);
+    
+    for (int i = 0; i < num_y1564_services && (size_t)written < size; i++) {
+        const y1564_service *svc = &y1564_services[i];
+        
+        written += snprintf(buf + written, size - written,
+                "%s{\"name\":\"%s\",\"stream_id\":%u,\"frame_size\":%u,\"cir_mbps\":%.3f,"
+                "\"eir_mbps\":%.3f,\"policing\":%s,\"configuration\":{\"passed\":%s,\"steps\":[",
+                i > 0 ? "," : "", svc->prof.name, svc->prof.stream_id, svc->frame_size,
+                svc->cir_mbps, svc->eir_mbps, svc->policing ? "true" : "false",
+                svc->config_passed ? "true" : "false");
+        
+        for (uint8_t s = 0; s < svc->num_steps && (size_t)written < size; s++) {
+            if (s > 0) written += snprintf(buf + written, size - written, ",");
+            if ((size_t)written < size) {
+                written += y1564_format_measurement(buf + written, size - written, &svc->steps[s]);
+            }
+        }
+        
+        if ((size_t)written < size) {
+            double avail_pct = svc->perf_seconds ?
+                    (svc->perf_seconds - svc->unavail_seconds) * 100.0 / svc->perf_seconds : 0.0;
+            written += snprintf(buf + written, size - written,
+                    "]},\"performance\":{\"passed\":%s,\"seconds\":%lu,\"unavailable_seconds\":%lu,"
+                    "\"availability_pct\":%.4f,\"result\":",
+                    svc->perf_passed ? "true" : "false", svc->perf_seconds,
+                    svc->unavail_seconds, avail_pct);
+        }
+        if ((size_t)written < size) {
+            written += y1564_format_measurement(buf + written, size - written, &svc->perf);
+        }
+        if ((size_t)written < size) {
+            written += snprintf(buf + written, size - written, "}}");
+        }
+    }
+    
+    if ((size_t)written < size) snprintf(buf + written, size - written, "]}}\n");
+}
+
+// RFC 2889 address caching capacity (5.7) and learning rate (5.8) with two
+// ports. Learning frames from the TX port carry N source addresses; test
+// frames from the same port are then sent to those N addresses. A switch
+// filters frames for addresses it learned on the ingress port, so every test
+// frame seen on the RX port was flooded: its address was not learned.
+struct rfc2889_test {
+    bool run_caching;
+    bool run_learning_rate;
+    uint16_t frame_size;
+    uint32_t max_addresses;
+    double learning_rate_fps;       // Rate used by the caching test
+    double max_learning_rate_fps;   // Upper bound of the learning rate search
+    uint32_t learning_addresses;    // Table size used by the learning rate test
+    double resolution_pct;
+    uint32_t aging_time_sec;        // Wait between trials for the table to age out
+    
+    // Results
+    uint32_t capacity_addresses;
+    uint32_t capacity_trials;
+    double learning_rate_result_fps;
+    uint32_t learning_rate_addresses;
+    uint32_t learning_rate_trials;
+};
+
+static rfc2889_test rfc2889;
+static bool rfc2889_short_send = false;     // A trial could not send all its frames
+
+// Send profile 0's exact frame count from zeroed counters, then stop after
+// 'drain_ms'. Returns false if aborted or if TX could not send every frame.
+static bool rfc2889_send(uint32_t drain_ms, double fps) {
+    traffic_profile *prof = &profiles[0];
+    uint32_t timeout_ms = (uint32_t)(prof->packets_to_send * 2000.0 / fps) + 1000;
+    bool completed = true;
+    
+    reset_traffic_stats();
+    start_traffic();
+    for (uint32_t waited = 0; profile_packets_sent(prof) < prof->packets_to_send && completed &&
+                              waited < timeout_ms; waited += 10) {
+        completed = test_sleep_ms(&rfc2889_prog, 10);
+    }
+    stop_traffic(drain_ms);
+    
+    // Unsent learning frames would read as flooding, unsent test frames as
+    // learned: the trial cannot be scored
+    uint64_t sent = profile_packets_sent(prof);
+    if (completed && sent < prof->packets_to_send) {
+        RTE_LOG(ERR, USER1, "RFC 2889: sent only %lu of %lu frames, trial invalid\n",
+                sent, prof->packets_to_send);
+        rfc2889_short_send = true;
+        return false;
+    }
+    return completed;
+}
+
+// One learning + test cycle for 'addresses' MACs learned at 'learn_fps'.
+// Each trial uses a fresh address range so entries left from earlier trials
+// never count as learned. Fills the number of flooded test frames.
+static bool rfc2889_trial(uint32_t addresses, double learn_fps, uint64_t *flooded) {
+    traffic_profile *prof = &profiles[0];
+    uint64_t base = RFC2889_MAC_BASE + (uint64_t)rfc2889_prog.trial * RFC2889_MAX_ADDRESSES;
+    double test_fps = RTE_MIN(rfc2889.learning_rate_fps, learn_fps);
+    
+    rfc2889_prog.trial++;
+    rfc2889_prog.trial_addresses = addresses;
+    rfc2889_prog.trial_rate_fps = learn_fps;
+    prof->packet_size = rfc2889.frame_size - RTE_ETHER_CRC_LEN;
+    prof->resolve_mac = false;          // Layer 2 test: the MACs are the test
+    prof->mac_count = addresses;
+    prof->packets_to_send = addresses;
+    
+    // Learning frames: one per source address, to the test port's own MAC
+    prof->mac_iterate = MAC_ITER_SRC;
+    prof->src_mac = base;
+    prof->dst_mac = RFC2889_TEST_SRC_MAC;
+    prof->mac_index = 0;
+    prof->stream_id = RFC2889_LEARN_STREAM;
+    prof->sequence_num = 0;
+    set_profile_rate_fps(prof, learn_fps);
+    if (!rfc2889_send(0, learn_fps)) return false;
+    if (!test_sleep_ms(&rfc2889_prog, RFC2889_SETTLE_MS)) return false;
+    
+    // Test frames: one per learned address
+    prof->mac_iterate = MAC_ITER_DST;
+    prof->src_mac = RFC2889_TEST_SRC_MAC;
+    prof->dst_mac = base;
+    prof->mac_index = 0;
+    prof->stream_id = RFC2889_TEST_STREAM;
+    prof->sequence_num = 0;
+    set_profile_rate_fps(prof, test_fps);
+    if (!rfc2889_send(RFC2544_DRAIN_MS, test_fps)) return false;
+    
+    rx_stream_state rx;
+    aggregate_stream_stats(RFC2889_TEST_STREAM, &rx, NULL);
+    *flooded = rx.in_order + rx.out_of_order + rx.late_arrivals;
+    rfc2889_prog.last_flooded = *flooded;
+    
+    RTE_LOG(INFO, USER1, "RFC 2889 %s trial %u: %u addresses @ %.0f fps, %lu flooded\n",
+            rfc2889_prog.phase, rfc2889_prog.trial, addresses, learn_fps, *flooded);
+    
+    return rfc2889.aging_time_sec == 0 || test_sleep_ms(&rfc2889_prog, rfc2889.aging_time_sec * 1000);
+}
+
+// 5.7: largest address count learned without flooding
+static bool rfc2889_caching(void) {
+    uint32_t lo = 0, hi = rfc2889.max_addresses, n = hi;
+    uint64_t flooded;
+    
+    rfc2889_prog.phase = "caching";
+    while (true) {
+        if (!rfc2889_trial(n, rfc2889.learning_rate_fps, &flooded)) return false;
+        rfc2889.capacity_trials++;
+        
+        if (flooded == 0) {
+            lo = n;
+            rfc2889.capacity_addresses = n;
+        } else {
+            hi = n;
+        }
+        
+        uint32_t resolution = RTE_MAX((uint32_t)(hi * rfc2889.resolution_pct / 100.0), 1u);
+        if (hi - lo <= resolution) break;
+        n = lo + (hi - lo) / 2;
+    }
+    return true;
+}
+
+// 5.8: highest learning rate at which a full table is learned without flooding
+static bool rfc2889_learning_rate(void) {
+    uint32_t addresses = rfc2889.learning_addresses ? rfc2889.learning_addresses :
+                         rfc2889.capacity_addresses ? rfc2889.capacity_addresses : 1000;
+    double lo = 0.0, hi = rfc2889.max_learning_rate_fps, rate = hi;
+    uint64_t flooded;
+    
+    rfc2889_prog.phase = "learning_rate";
+    rfc2889.learning_rate_addresses = addresses;
+    while (true) {
+        if (!rfc2889_trial(addresses, rate, &flooded)) return false;
+        rfc2889.learning_rate_trials++;
+        
+        if (flooded == 0) {
+            lo = rate;
+            rfc2889.learning_rate_result_fps = rate;
+        } else {
+            hi = rate;
+        }
+        
+        if (hi - lo <= hi * rfc2889.resolution_pct / 100.0) break;
+        rate = (lo + hi) / 2.0;
+    }
+    return true;
+}
+
+static void* rfc2889_thread(__rte_unused void *arg) {
+    if (num_profiles == 0) {
+        create_default_profile();
+    }
+    test_resolve_profiles();
+    traffic_profile saved = profiles[0];
+    int saved_num = num_profiles;
+    num_profiles = 1;
+    rfc2889_short_send = false;
+    
+    bool completed = true;
+    if (rfc2889.run_caching) completed = rfc2889_caching();
+    if (rfc2889.run_learning_rate && completed) completed = rfc2889_learning_rate();
+    
+    profiles[0] = saved;
+    num_profiles = saved_num;
+    
+    rfc2889_prog.state = completed ? "completed" : rfc2889_short_send ? "failed" : "aborted";
+    rfc2889_prog.active = false;
+    return NULL;
+}
+
+// Parse an rfc2889_start request and launch the test thread
+static const char* rfc2889_start(struct json_object *root) {
+    if (test_in_progress()) return test_in_progress();
+    if (running) return "Traffic is running, stop it first";
+    if (num_rx_lcores == 0) return "RFC 2889 needs an RX port and RX lcore";
+    
+    memset(&rfc2889, 0, sizeof(rfc2889));
+    rfc2889.run_caching = true;
+    rfc2889.run_learning_rate = true;
+    rfc2889.frame_size = 64;
+    rfc2889.max_addresses = RFC2889_MAX_ADDRESSES;
+    rfc2889.learning_rate_fps = 100000;
+    rfc2889.resolution_pct = 1.0;
+    
+    struct json_object *val;
+    if (json_object_object_get_ex(root, "tests", &val)) {
+        static const test_selection tests[] = {
+            {"caching", 1},
+            {"learning_rate", 2},
+        };
+        uint32_t selected;
+        const char *err = test_parse_selection(val, tests, RTE_DIM(tests), &selected,
+                                               "Unknown RFC 2889 test");
+        if (err) return err;
+        if (selected == 0) return "No RFC 2889 tests selected";
+        rfc2889.run_caching = selected & 1;
+        rfc2889.run_learning_rate = selected & 2;
+    }
+    if (json_object_object_get_ex(root, "frame_size", &val)) {
+        int size = json_object_get_int(val);
+        if (size < RTE_ETHER_MIN_LEN || size > RTE_ETHER_MAX_LEN) return "Invalid frame size";
+        rfc2889.frame_size = size;
+    }
+    if (json_object_object_get_ex(root, "max_addresses", &val)) {
+        int64_t n = json_object_get_int64(val);
+        if (n < 1 || n > RFC2889_MAX_ADDRESSES) return "max_addresses must be 1-1048576";
+        rfc2889.max_addresses = n;
+    }
+    if (json_object_object_get_ex(root, "learning_addresses", &val)) {
+        int64_t n = json_object_get_int64(val);
+        if (n < 1 || n > RFC2889_MAX_ADDRESSES) return "learning_addresses must be 1-1048576";
+        rfc2889.learning_addresses = n;
+    }
+    if (json_object_object_get_ex(root, "learning_rate_fps", &val)) {
+        rfc2889.learning_rate_fps = RTE_MAX(json_object_get_double(val), 1.0);
+    }
+    rfc2889.max_learning_rate_fps = line_rate_fps(rfc2889.frame_size);
+    if (json_object_object_get_ex(root, "max_learning_rate_fps", &val)) {
+        rfc2889.max_learning_rate_fps = RTE_MIN(RTE_MAX(json_object_get_double(val), 1.0),
+                                                rfc2889.max_learning_rate_fps);
+    }
+    if (json_object_object_get_ex(root, "resolution_pct", &val)) {
+        rfc2889.resolution_pct = RTE_MAX(json_object_get_double(val), 0.001);
+    }
+    if (json_object_object_get_ex(root, "aging_time_sec", &val)) {
+        rfc2889.aging_time_sec = RTE_MAX(json_object_get_int(val), 0);
+    }
+    
+    rfc2889_prog.trial = 0;
+    rfc2889_prog.trial_addresses = 0;
+    rfc2889_prog.trial_rate_fps = 0;
+    rfc2889_prog.last_flooded = 0;
+    
+    return test_launch(&rfc2889_prog, rfc2889_thread) ? NULL : "Failed to start RFC 2889 thread";
+}
+
+// Progress and results as JSON
+static void rfc2889_format_status(char *buf, size_t size) {
+    snprintf(buf, size,
+            "{\"status\":\"success\",\"data\":{\"state\":\"%s\",\"phase\":\"%s\",\"trial\":%u,"
+            "\"trial_addresses\":%u,\"trial_rate_fps\":%.0f,\"last_flooded\":%lu,"
+            "\"frame_size\":%u,\"caching\":{\"max_addresses\":%u,\"learning_rate_fps\":%.0f,"
+            "\"capacity_addresses\":%u,\"trials\":%u},"
+            "\"learning_rate\":{\"addresses\":%u,\"learning_rate_fps\":%.0f,\"trials\":%u}}}\n",
+            rfc2889_prog.state, rfc2889_prog.phase, rfc2889_prog.trial,
+            rfc2889_prog.trial_addresses, rfc2889_prog.trial_rate_fps, rfc2889_prog.last_flooded,
+            rfc2889.frame_size, rfc2889.max_addresses, rfc2889.learning_rate_fps,
+            rfc2889.capacity_addresses, rfc2889.capacity_trials,
+            rfc2889.learning_rate_addresses, rfc2889.learning_rate_result_fps,
+            rfc2889.learning_rate_trials);
+}
+
+// ============================================================================
+// DPDK TELEMETRY
+// ============================================================================
+// /netgen/* commands for the rte_telemetry socket (dpdk-telemetry.py), next
+// to the built-in /ethdev and /mempool ones. Callbacks run on the
+// telemetry thread and read the same lock-free snapshot as the exporters.
+// Profiles are keyed by stream id: telemetry dict keys only allow
+// alphanumerics, '_', '-' and '.', which profile names need not follow.
+
+static netgen_stats_region* telemetry_snapshot(void) {
+    netgen_stats_region *snap = (netgen_stats_region*)calloc(1, sizeof(netgen_stats_region));
+    if (snap) stats_shm_read(snap);
+    return snap;
+}
+
+// Optional stream id parameter; -1 selects every profile
+static int telemetry_stream_param(const char *params) {
+    if (!params || !*params) return -1;
+    char *end;
+    long id = strtol(params, &end, 10);
+    return (*end == '\0' && id >= 0 && id < MAX_STREAMS) ? (int)id : -2;
+}
+
+static int telemetry_info(__rte_unused const char *cmd, __rte_unused const char *params,
+                          struct rte_tel_data *d) {
+    const char *test = test_in_progress();
+    
+    rte_tel_data_start_dict(d);
+    rte_tel_data_add_dict_uint(d, "running", running ? 1 : 0);
+    rte_tel_data_add_dict_string(d, "test", test ? test : "none");
+    rte_tel_data_add_dict_uint(d, "profiles", num_profiles);
+    rte_tel_data_add_dict_uint(d, "tx_lcores", num_tx_lcores);
+    rte_tel_data_add_dict_uint(d, "rx_lcores", num_rx_lcores);
+    rte_tel_data_add_dict_uint(d, "tx_port", tx_port);
+    rte_tel_data_add_dict_int(d, "rx_port", dual_port_mode ? rx_port : -1);
+    rte_tel_data_add_dict_int(d, "tx_port_socket", port_socket(tx_port));
+    rte_tel_data_add_dict_int(d, "rx_port_socket", dual_port_mode ? port_socket(rx_port) : -1);
+    rte_tel_data_add_dict_string(d, "rx_clock", rx_hw_timestamp ? "nic" : "tsc");
+    return 0;
+}
+
+static int telemetry_profiles(__rte_unused const char *cmd, const char *params,
+                              struct rte_tel_data *d) {
+    int stream = telemetry_stream_param(params);
+    if (stream == -2) return -EINVAL;
+    
+    netgen_stats_region *snap = telemetry_snapshot();
+    if (!snap) return -ENOMEM;
+    
+    rte_tel_data_start_dict(d);
+    for (uint32_t i = 0; i < snap->header.num_profiles; i++) {
+        const netgen_stats_profile *p = &snap->profiles[i];
+        if (stream >= 0 && p->stream_id != stream) continue;
+        
+        char key[8];
+        snprintf(key, sizeof(key), "%u", p->stream_id);
+        
+        struct rte_tel_data *c = rte_tel_data_alloc();
+        if (!c) break;
+        rte_tel_data_start_dict(c);
+        rte_tel_data_add_dict_string(c, "name", p->name);
+        rte_tel_data_add_dict_uint(c, "packets_sent", p->packets_sent);
+        rte_tel_data_add_dict_uint(c, "bytes_sent", p->bytes_sent);
+        rte_tel_data_add_dict_uint(c, "packets_dropped", p->packets_dropped);
+        rte_tel_data_add_dict_uint(c, "packets_received", p->packets_received);
+        rte_tel_data_add_dict_uint(c, "bytes_received", p->bytes_received);
+        rte_tel_data_add_dict_uint(c, "lost_packets", p->lost_packets);
+        rte_tel_data_add_dict_uint(c, "out_of_order", p->out_of_order);
+        rte_tel_data_add_dict_uint(c, "duplicates", p->duplicates);
+        rte_tel_data_add_dict_uint(c, "late_arrivals", p->late_arrivals);
+        rte_tel_data_add_dict_container(d, key, c, 0);
+    }
+    
+    free(snap);
+    return 0;
+}
+
+static int telemetry_latency(__rte_unused const char *cmd, const char *params,
+                             struct rte_tel_data *d) {
+    int stream = telemetry_stream_param(params);
+    if (stream == -2) return -EINVAL;
+    
+    netgen_stats_region *snap = telemetry_snapshot();
+    if (!snap) return -ENOMEM;
+    
+    rte_tel_data_start_dict(d);
+    for (uint32_t i = 0; i < snap->header.num_profiles; i++) {
+        const netgen_stats_profile *p = &snap->profiles[i];
+        if (stream >= 0 && p->stream_id != stream) continue;
+        
+        char key[8];
+        snprintf(key, sizeof(key), "%u", p->stream_id);
+        
+        struct rte_tel_data *c = rte_tel_data_alloc();
+        if (!c) break;
+        rte_tel_data_start_dict(c);
+        rte_tel_data_add_dict_string(c, "name", p->name);
+        rte_tel_data_add_dict_uint(c, "count", p->latency_count);
+        rte_tel_data_add_dict_uint(c, "min_ns", p->latency_min_ns);
+        rte_tel_data_add_dict_uint(c, "avg_ns", p->latency_avg_ns);
+        rte_tel_data_add_dict_uint(c, "max_ns", p->latency_max_ns);
+        rte_tel_data_add_dict_uint(c, "p50_ns", p->latency_p50_ns);
+        rte_tel_data_add_dict_uint(c, "p99_ns", p->latency_p99_ns);
+        rte_tel_data_add_dict_uint(c, "p999_ns", p->latency_p999_ns);
+        rte_tel_data_add_dict_uint(c, "jitter_ns", p->jitter_ns);
+        rte_tel_data_add_dict_container(d, key, c, 0);
+    }
+    
+    free(snap);
+    return 0;
+}
+
+static int telemetry_lcores(__rte_unused const char *cmd, __rte_unused const char *params,
+                            struct rte_tel_data *d) {
+    netgen_stats_region *snap = telemetry_snapshot();
+    if (!snap) return -ENOMEM;
+    
+    rte_tel_data_start_dict(d);
+    for (uint32_t i = 0; i < snap->header.num_lcores; i++) {
+        const netgen_stats_lcore *l = &snap->lcores[i];
+        char name[16];
+        snprintf(name, sizeof(name), "%u", l->lcore_id);
+        
+        struct rte_tel_data *c = rte_tel_data_alloc();
+        if (!c) break;
+        rte_tel_data_start_dict(c);
+        rte_tel_data_add_dict_string(c, "role", l->role == NETGEN_STATS_LCORE_TX ? "tx" :
+                                               l->role == NETGEN_STATS_LCORE_RX ? "rx" : "idle");
+        rte_tel_data_add_dict_uint(c, "queue", l->queue_id);
+        rte_tel_data_add_dict_uint(c, "socket", rte_lcore_to_socket_id(l->lcore_id));
+        rte_tel_data_add_dict_uint(c, "packets", l->packets);
+        rte_tel_data_add_dict_uint(c, "bytes", l->bytes);
+        rte_tel_data_add_dict_uint(c, "unsigned_packets", l->unsigned_packets);
+#ifdef ENABLE_CYCLE_STATS
+        rte_tel_data_add_dict_uint(c, "busy_cycles", l->busy_cycles);
+        rte_tel_data_add_dict_uint(c, "idle_cycles", l->idle_cycles);
+        rte_tel_data_add_dict_uint(c, "busy_polls", l->busy_polls);
+        rte_tel_data_add_dict_uint(c, "idle_polls", l->idle_polls);
+        if (l->role == NETGEN_STATS_LCORE_TX) {
+            for (int s = 0; s < TX_STAGE_MAX; s++) {
+                char key[32];
+                snprintf(key, sizeof(key), "%s_cycles", tx_stage_names[s]);
+                rte_tel_data_add_dict_uint(c, key, l->stage_cycles[s]);
+            }
+        }
+#endif
+        if (l->role == NETGEN_STATS_LCORE_TX) {
+            rte_tel_data_add_dict_uint(c, "tx_queue_full", l->tx_queue_full);
+            rte_tel_data_add_dict_uint(c, "alloc_failures", l->alloc_failures);
+        }
+        rte_tel_data_add_dict_container(d, name, c, 0);
+    }
+    
+    free(snap);
+    return 0;
+}
+
+void register_telemetry(void) {
+    rte_telemetry_register_cmd("/netgen/info", telemetry_info,
+            "Engine state. Takes no parameters");
+    rte_telemetry_register_cmd("/netgen/profiles", telemetry_profiles,
+            "Per-profile TX/RX counters. Parameters: optional stream id");
+    rte_telemetry_register_cmd("/netgen/latency", telemetry_latency,
+            "Per-profile latency summary. Parameters: optional stream id");
+    rte_telemetry_register_cmd("/netgen/lcores", telemetry_lcores,
+            "Per worker lcore role and counters. Takes no parameters");
+}
+
+// Cycle accounting of one lcore as the tail of a JSON object: busy share of
+// polls, busy cycles per frame and, for TX, cycles per frame by stage.
+// Without ENABLE_CYCLE_STATS only the object is closed.
+// Returns the length written, or -1 if it did not fit in 'remaining'.
+#ifdef ENABLE_CYCLE_STATS
+static int format_cycle_stats(char *p, size_t remaining, const lcore_cycle_stats *cs,
+                              uint64_t packets, bool tx) {
+    uint64_t total = cs->busy_cycles + cs->idle_cycles;
+    int written = snprintf(p, remaining,
+            ",\"busy_pct\":%.2f,\"busy_cycles\":%lu,\"idle_cycles\":%lu,\"cycles_per_packet\":%.1f",
+            total ? cs->busy_cycles * 100.0 / total : 0.0, cs->busy_cycles, cs->idle_cycles,
+            packets ? (double)cs->busy_cycles / packets : 0.0);
+    if (written < 0) return -1;
+    
+    if (tx && (size_t)written < remaining) {
+        written += snprintf(p + written, remaining - written, ",\"stage_cycles_per_packet\":{");
+        for (int i = 0; i < TX_STAGE_MAX && (size_t)written < remaining; i++) {
+            written += snprintf(p + written, remaining - written, "%s\"%s\":%.1f",
+                                i > 0 ? "," : "", tx_stage_names[i],
+                                packets ? (double)cs->stage_cycles[i] / packets : 0.0);
+        }
+        if ((size_t)written < remaining) written += snprintf(p + written, remaining - written, "}");
+    }
+    if ((size_t)written < remaining) written += snprintf(p + written, remaining - written, "}");
+    return (size_t)written < remaining ? written : -1;
+}
+#else
+static int format_cycle_stats(char *p, size_t remaining, const lcore_cycle_stats*, uint64_t, bool) {
+    int written = snprintf(p, remaining, "}");
+    return written >= 0 && (size_t)written < remaining ? written : -1;
+}
+#endif
+
+// Optional addressing keys of the start command, applied to every profile:
+// src_ip, src_ip_count, gateway, resolve_mac
+static const char* apply_start_addressing(struct json_object *root) {
+    struct json_object *val;
+    
+    if (num_profiles == 0) {
+        create_default_profile();
+    }
+    
+    for (int i = 0; i < num_profiles; i++) {
+        traffic_profile *prof = &profiles[i];
+        
+        if (json_object_object_get_ex(root, "src_ip", &val)) {
+            struct in_addr addr;
+            if (inet_pton(AF_INET, json_object_get_string(val), &addr) != 1) return "Invalid src_ip";
+            prof->src_ip = ntohl(addr.s_addr);
+        }
+        if (json_object_object_get_ex(root, "src_ip_count", &val)) {
+            int count = json_object_get_int(val);
+            if (count < 1) return "Invalid src_ip_count";
+            prof->src_ip_count = count;
+        }
+        if (json_object_object_get_ex(root, "gateway", &val)) {
+            struct in_addr addr;
+            if (inet_pton(AF_INET, json_object_get_string(val), &addr) != 1) return "Invalid gateway";
+            prof->gateway_ip = ntohl(addr.s_addr);
+        }
+        if (json_object_object_get_ex(root, "resolve_mac", &val)) {
+            prof->resolve_mac = json_object_get_boolean(val);
+        }
+    }
+    return NULL;
+}
+
+// The start/stop/status commands of the test orchestrators
+struct test_runner {
+    const char *prefix;         // Commands are <prefix>start, <prefix>stop, <prefix>status
+    const char *name;
+    test_progress *prog;
+    const char* (*start)(struct json_object *root);     // Error message or NULL
+    void (*format_status)(char *buf, size_t size);
+};
+
+static const test_runner test_runners[] = {
+    {"rfc2544_", "RFC 2544", &rfc2544_prog, rfc2544_start, rfc2544_format_status},
+    {"y1564_", "Y.1564", &y1564_prog, y1564_start, y1564_format_status},
+    {"rfc2889_", "RFC 2889", &rfc2889_prog, rfc2889_start, rfc2889_format_status},
+};
+
+// Returns false if 'command' is not a test runner command
+static bool test_runner_command(int client_sock, const char *command, struct json_object *root) {
+    for (const test_runner &t : test_runners) {
+        size_t len = strlen(t.prefix);
+        if (strncmp(command, t.prefix, len) != 0) continue;
+        const char *verb = command + len;
+        
+        if (strcmp(verb, "start") == 0) {
+            const char *err = t.start(root);
+            char response[256];
+            if (err) {
+                snprintf(response, sizeof(response), "{\"status\":\"error\",\"message\":\"%s\"}\n", err);
+            } else {
+                snprintf(response, sizeof(response), "{\"status\":\"success\",\"message\":\"%s started\"}\n",
+                         t.name);
+            }
+            control_send(client_sock, response, strlen(response));
+        } else if (strcmp(verb, "stop") == 0) {
+            t.prog->abort = true;
+            const char *response = "{\"status\":\"success\",\"message\":\"Abort requested\"}\n";
+            control_send(client_sock, response, strlen(response));
+        } else if (strcmp(verb, "status") == 0) {
+            static char status_json[32768];     // Control thread only
+            t.format_status(status_json, sizeof(status_json));
+            control_send(client_sock, status_json, strlen(status_json));
+        } else {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// A "start" waits for ARP resolution without blocking the control thread:
+// the control loop polls it and replies to the client that sent it
+static bool start_pending = false;
+static int start_waiter = -1;       // -1 once that client has gone
+
+static void control_start_reply(const char *err) {
+    if (start_waiter < 0) return;
+    
+    char response[256];
+    if (err) {
+        snprintf(response, sizeof(response), "{\"status\":\"error\",\"message\":\"%s\"}\n", err);
+    } else {
+        snprintf(response, sizeof(response), "{\"status\":\"success\",\"message\":\"Started\"}\n");
+    }
+    control_send(start_waiter, response, strlen(response));
+    start_waiter = -1;
+}
+
+static void control_start_poll(void) {
+    if (!start_pending) return;
+    
+    bool pending;
+    const char *err = arp_apply_profiles(&pending);
+    if (pending) return;
+    
+    start_pending = false;
+    if (!err && test_in_progress()) err = test_in_progress();
+    if (!err && running) err = "Traffic is already running";
+    if (!err) start_traffic();
+    control_start_reply(err);
+}
+
+// Control socket command handler
+void handle_control_command(int client_sock, const char *cmd_json) {
+    struct json_object *root = json_tokener_parse(cmd_json);
+    if (!root) {
+        const char *error = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}\n";
+        control_send(client_sock, error, strlen(error));
+        return;
+    }
+    
+    struct json_object *cmd_obj;
+    if (!json_object_object_get_ex(root, "command", &cmd_obj)) {
+        const char *error = "{\"status\":\"error\",\"message\":\"No command specified\"}\n";
+        control_send(client_sock, error, strlen(error));
+        json_object_put(root);
+        return;
+    }
+    
+    const char *command = json_object_get_string(cmd_obj);
+    
+    if ((strcmp(command, "start") == 0 || strcmp(command, "stop") == 0 ||
+         strcmp(command, "reset_stats") == 0) && test_in_progress()) {
+        char error[128];
+        snprintf(error, sizeof(error), "{\"status\":\"error\",\"message\":\"%s\"}\n", test_in_progress());
+        control_send(client_sock, error, strlen(error));
+        
+    } else if (strcmp(command, "start") == 0) {
+        const char *err = start_pending ? "Start already pending" : apply_start_addressing(root);
+        if (!err && arp_queue_profiles() && !arp_ring) err = "ARP resolver disabled (--no-arp)";
+        
+        if (err) {
+            char response[256];
+            snprintf(response, sizeof(response), "{\"status\":\"error\",\"message\":\"%s\"}\n", err);
+            control_send(client_sock, response, strlen(response));
+        } else {
+            // Answered by control_start_poll() once the next hops resolve
+            start_pending = true;
+            start_waiter = client_sock;
+            control_start_poll();
+        }
+        
+    } else if (strcmp(command, "topology") == 0) {
+        std::string out;
+        topology_format_json(out);
+        control_send(client_sock, out.data(), out.size());
+        
+    } else if (strcmp(command, "neighbors") == 0) {
+        std::string out;
+        arp_format_json(out);
+        control_send(client_sock, out.data(), out.size());
+        
+    } else if (strcmp(command, "discovery_scan") == 0) {
+        const char *err = discovery_scan_start(root);
+        char response[256];
+        if (err) {
+            snprintf(response, sizeof(response), "{\"status\":\"error\",\"message\":\"%s\"}\n", err);
+        } else {
+            snprintf(response, sizeof(response), "{\"status\":\"success\",\"message\":\"Scan started\"}\n");
+        }
+        control_send(client_sock, response, strlen(response));
+        
+    } else if (strcmp(command, "discovery_stop") == 0) {
+        dpdk_scan_subnet_abort();
+        const char *response = "{\"status\":\"success\",\"message\":\"Scan stopped\"}\n";
+        control_send(client_sock, response, strlen(response));
+        
+    } else if (strcmp(command, "discovery_status") == 0) {
+        uint32_t offset, limit;
+        discovery_page(root, &offset, &limit);
+        
+        std::vector<char> buf(DISCOVERY_JSON_SIZE);
+        dpdk_scan_subnet_status(offset, limit, buf.data(), buf.size() - 1);
+        strcat(buf.data(), "\n");
+        control_send(client_sock, buf.data(), strlen(buf.data()));
+        
+    } else if (strcmp(command, "discovered_devices") == 0) {
+        struct json_object *val;
+        uint16_t port = tx_port;
+        if (json_object_object_get_ex(root, "port", &val)) port = json_object_get_int(val);
+        uint32_t offset, limit;
+        discovery_page(root, &offset, &limit);
+        
+        std::vector<char> buf(DISCOVERY_JSON_SIZE);
+        uint32_t devices, total;
+        uint64_t table_full;
+        dpdk_discovery_stats(&devices, &table_full);
+        int len = snprintf(buf.data(), buf.size(),
+                           "{\"status\":\"success\",\"port\":%u,\"table_devices\":%u,"
+                           "\"table_full\":%lu,\"devices\":", port, devices, table_full);
+        uint32_t count = dpdk_get_discovered_devices(port, offset, limit, buf.data() + len,
+                                                     buf.size() - len - 128, &total);
+        len += strlen(buf.data() + len);
+        snprintf(buf.data() + len, buf.size() - len,
+                 ",\"offset\":%u,\"count\":%u,\"total\":%u,\"truncated\":%s}\n",
+                 offset, count, total, offset + count < total ? "true" : "false");
+        control_send(client_sock, buf.data(), strlen(buf.data()));
+        
+    } else if (strcmp(command, "multiprocess") == 0) {
+        char response[1024];
+        mp_format_json(response, sizeof(response));
+        control_send(client_sock, response, strlen(response));
+        
+    } else if (strcmp(command, "stop") == 0) {
+        if (start_pending) {
+            start_pending = false;
+            control_start_reply("Stopped before ARP resolution finished");
+        }
+        stop_traffic(0);
+        
+        const char *response = "{\"status\":\"success\",\"message\":\"Stopped\"}\n";
+        control_send(client_sock, response, strlen(response));
+        
+    } else if (strcmp(command, "reset_stats") == 0) {
+        if (running) {
+            const char *error = "{\"status\":\"error\",\"message\":\"Stop traffic before resetting\"}\n";
+            control_send(client_sock, error, strlen(error));
+        } else {
+            reset_traffic_stats();
+            const char *response = "{\"status\":\"success\",\"message\":\"Statistics reset\"}\n";
+            control_send(client_sock, response, strlen(response));
+        }
+        
+    } else if (strcmp(command, "rfc2544_watch") == 0) {
+        // Stream one JSON message per trial on this connection. The control
+        // thread then drops the connection from its epoll set, so only
+        // rfc2544_notify writes to it and messages never interleave.
+        const char *response = "{\"status\":\"success\",\"message\":\"Watching\"}\n";
+        control_send(client_sock, response, strlen(response));
+        
+        pthread_mutex_lock(&rfc2544_mutex);
+        if (rfc2544_prog.active && num_rfc2544_watchers < RFC2544_MAX_WATCHERS) {
+            control_client &client = control_clients[client_sock];
+            rfc2544_watchers[num_rfc2544_watchers].fd = client_sock;
+            rfc2544_watchers[num_rfc2544_watchers++].framing = client.framing;
+            client.watcher = true;
+        }
+        pthread_mutex_unlock(&rfc2544_mutex);
+        
+    } else if (strcmp(command, "timeseries") == 0) {
+        struct json_object *val;
+        uint64_t since = 0;
+        uint32_t max = 1000;
+        uint32_t step = 1;
+        bool binary = false;
+
+        if (json_object_object_get_ex(root, "since", &val)) since = json_object_get_int64(val);
+        if (json_object_object_get_ex(root, "max", &val)) {
+            max = RTE_MIN(RTE_MAX(json_object_get_int(val), 1), TIMESERIES_MAX_BATCH);
+        }
+        if (json_object_object_get_ex(root, "interval_us", &val)) {
+            // Per request: every n-th sample, never finer than the sampler
+            uint64_t interval_us = RTE_MAX(json_object_get_int64(val), (int64_t)0);
+            step = RTE_MIN(RTE_MAX((interval_us + timeseries_interval_us / 2) / timeseries_interval_us,
+                                   (uint64_t)1), (uint64_t)TIMESERIES_RING_SIZE / 2);
+        }
+        if (json_object_object_get_ex(root, "format", &val)) {
+            binary = strcmp(json_object_get_string(val), "binary") == 0;
+        }
+        
+        if (!timeseries_ring) {
+            const char *error = "{\"status\":\"error\",\"message\":\"Time series disabled (--timeseries-us)\"}\n";
+            control_send(client_sock, error, strlen(error));
+        } else if (binary && control_clients[client_sock].framing != CONTROL_FRAMING_LENGTH) {
+            const char *error = "{\"status\":\"error\",\"message\":\"Binary format needs a length-framed connection\"}\n";
+            control_send(client_sock, error, strlen(error));
+        } else {
+            std::vector<timeseries_sample> samples;
+            uint64_t next;
+            uint64_t first = timeseries_copy(since, max, step, samples, &next);
+            uint32_t interval_us = step * timeseries_interval_us;
+            std::string out;
+            if (binary) {
+                // Binary keeps every copied sample: counters are cumulative
+                timeseries_format_binary(out, interval_us, first, next, samples);
+            } else {
+                timeseries_format_json(out, interval_us, first, next, samples);
+            }
+            control_send(client_sock, out.data(), out.size());
+        }
+        
+    } else if (strcmp(command, "stats") == 0) {
+        char stats_json[65536];
+        uint64_t hist[LAT_HIST_BUCKETS];
+        char *p = stats_json;
+        size_t remaining = sizeof(stats_json);
+        int written;
+        uint64_t total_tx = 0, total_bytes = 0;
+        tx_counters tx_cnt[MAX_PROFILES];
+        rx_stats rx_totals;
+        uint64_t out_of_order = 0, duplicates = 0, late_arrivals = 0, lost_packets = 0;
+        uint64_t lat_min = 0, lat_max = 0, lat_sum = 0, lat_count = 0;
+        
+        for (int i = 0; i < num_profiles; i++) {
+            aggregate_tx_stats(i, &tx_cnt[i]);
+            total_tx += tx_cnt[i].packets_sent;
+            total_bytes += tx_cnt[i].bytes_sent;
+        }
+        
+        written = snprintf(p, remaining, "{\"status\":\"success\",\"data\":{\"streams\":[");
+        p += written;
+        remaining -= written;       // Fixed prefix, always fits
+        
+        // Per-stream sequence analysis: lost = sent - unique received. Every
+        // stream counts towards the totals; the list stops when out of room.
+        int count = 0;
+        bool streams_truncated = false;
+        for (int i = 0; i < num_profiles; i++) {
+            uint16_t stream_id = profiles[i].stream_id;
+            if (stream_id >= MAX_STREAMS) continue;
+            
+            rx_stream_state st;
+            aggregate_stream_stats(stream_id, &st, hist);
+            
+            // RFC 5481 PDV: delay quantile relative to the minimum delay
+            uint64_t p50 = lat_hist_quantile(hist, st.latency_count, 500);
+            uint64_t p99 = lat_hist_quantile(hist, st.latency_count, 990);
+            uint64_t p999 = lat_hist_quantile(hist, st.latency_count, 999);
+            uint64_t pdv_p99 = p99 > st.latency_min_ns ? p99 - st.latency_min_ns : 0;
+            uint64_t pdv_p999 = p999 > st.latency_min_ns ? p999 - st.latency_min_ns : 0;
+            
+            uint64_t unique = st.in_order + st.out_of_order + st.late_arrivals;
+            uint64_t lost = tx_cnt[i].packets_sent > unique ? tx_cnt[i].packets_sent - unique : 0;
+            
+            out_of_order += st.out_of_order;
+            duplicates += st.duplicates;
+            late_arrivals += st.late_arrivals;
+            lost_packets += lost;
+            
+            if (st.latency_count > 0) {
+                if (lat_count == 0 || st.latency_min_ns < lat_min) lat_min = st.latency_min_ns;
+                lat_max = RTE_MAX(lat_max, st.latency_max_ns);
+                lat_sum += st.latency_sum_ns;
+                lat_count += st.latency_count;
+            }
+            
+            const char *clock_source = st.latency_count == 0 ? "none" :
+                                       st.hw_timestamps == st.latency_count ? "nic" :
+                                       st.hw_timestamps == 0 ? "tsc" : "mixed";
+            
+            if (streams_truncated || remaining <= 1024) {
+                streams_truncated = true;
+                continue;
+            }
+            written = snprintf(p, remaining,
+                    "%s{\"stream_id\":%u,\"name\":\"%s\","
+                    "\"packets_sent\":%lu,"
+                    "\"packets_received\":%lu,"
+                    "\"bytes_received\":%lu,"
+                    "\"out_of_order\":%lu,"
+                    "\"duplicates\":%lu,"
+                    "\"late_arrivals\":%lu,"
+                    "\"lost_packets\":%lu,"
+                    "\"expected_seq\":%u,"
+                    "\"latency_min_ns\":%lu,"
+                    "\"latency_avg_ns\":%lu,"
+                    "\"latency_max_ns\":%lu,"
+                    "\"latency_p50_ns\":%lu,"
+                    "\"latency_p99_ns\":%lu,"
+                    "\"latency_p999_ns\":%lu,"
+                    "\"jitter_ns\":%lu,"
+                    "\"ipdv_min_ns\":%ld,"
+                    "\"ipdv_max_ns\":%ld,"
+                    "\"ipdv_mean_abs_ns\":%lu,"
+                    "\"pdv_p99_ns\":%lu,"
+                    "\"pdv_p999_ns\":%lu,"
+                    "\"clock_source\":\"%s\"}",
+                    count > 0 ? "," : "", stream_id, profiles[i].name,
+                    tx_cnt[i].packets_sent,
+                    unique + st.duplicates, st.bytes,
+                    st.out_of_order, st.duplicates, st.late_arrivals, lost,
+                    st.seen ? st.max_seq + 1 : 0,
+                    st.latency_min_ns,
+                    st.latency_count ? st.latency_sum_ns / st.latency_count : 0,
+                    st.latency_max_ns, p50, p99, p999,
+                    st.jitter_q4 >> 4,
+                    st.ipdv_min_ns, st.ipdv_max_ns,
+                    st.ipdv_count ? st.ipdv_abs_sum_ns / st.ipdv_count : 0,
+                    pdv_p99, pdv_p999, clock_source);
+            if (written < 0 || (size_t)written >= remaining) {
+                streams_truncated = true;
+                continue;
+            }
+            p += written;
+            remaining -= written;
+            count++;
+        }
+        
+        aggregate_rx_stats(&rx_totals);
+        
+        // Rate over the last second from the time series, else the mean since start
+        double tx_rate_mbps = 0, rx_rate_mbps = 0;
+        if (!timeseries_recent_rate(1000, &tx_rate_mbps, &rx_rate_mbps) && traffic_start_tsc) {
+            double elapsed = (double)(rte_get_tsc_cycles() - traffic_start_tsc) / rte_get_tsc_hz();
+            tx_rate_mbps = elapsed > 0 ? total_bytes * 8.0 / elapsed / 1e6 : 0;
+            rx_rate_mbps = elapsed > 0 ? rx_totals.bytes_received * 8.0 / elapsed / 1e6 : 0;
+        }
+        rx_totals.out_of_order = out_of_order;
+        rx_totals.duplicates = duplicates;
+        rx_totals.late_arrivals = late_arrivals;
+        rx_totals.lost_packets = lost_packets;
+        rx_totals.min_latency_ns = lat_min;
+        rx_totals.max_latency_ns = lat_max;
+        rx_totals.sum_latency_ns = lat_sum;
+        rx_totals.latency_count = lat_count;
+        
+        snprintf(p, remaining,
+                "],\"streams_truncated\":%s,\"tx_lcores\":[", streams_truncated ? "true" : "false");
+        p += strlen(p);
+        remaining = sizeof(stats_json) - (p - stats_json);
+        
+        count = 0;
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE && remaining > 640; lcore_id++) {
+            const tx_lcore_state *state = lcore_confs[lcore_id].tx;
+            if (!state) continue;
+            
+            const lcore_cycle_stats *cs = &state->cycles;
+            char *record = p;
+            written = snprintf(p, remaining,
+                    "%s{\"queue\":%u,\"lcore\":%u,\"packets\":%lu,\"bytes\":%lu,\"dropped\":%lu,"
+                    "\"tx_queue_full\":%lu,\"alloc_failures\":%lu",
+                    count > 0 ? "," : "", lcore_confs[lcore_id].queue_id, lcore_id,
+                    state->total.packets_sent, state->total.bytes_sent, state->total.packets_dropped,
+                    cs->tx_queue_full, cs->alloc_failures);
+            if (written < 0 || (size_t)written >= remaining) break;
+            p += written;
+            remaining -= written;
+            written = format_cycle_stats(p, remaining, cs, state->total.packets_sent, true);
+            if (written < 0) {
+                p = record;                 // Drop the half-written record
+                remaining = sizeof(stats_json) - (p - stats_json);
+                break;
+            }
+            p += written;
+            remaining -= written;
+            count++;
+        }
+        
+        snprintf(p, remaining,
+                "],\"rx_queues\":[");
+        p += strlen(p);
+        remaining = sizeof(stats_json) - (p - stats_json);
+        
+        count = 0;
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE && remaining > 640; lcore_id++) {
+            rx_lcore_state *state = lcore_confs[lcore_id].rx;
+            if (!state) continue;
+            
+            char *record = p;
+            written = snprintf(p, remaining,
+                    "%s{\"queue\":%u,\"lcore\":%u,\"packets\":%lu,\"bytes\":%lu",
+                    count > 0 ? "," : "", lcore_confs[lcore_id].queue_id, lcore_id,
+                    state->packets_received, state->bytes_received);
+            if (written < 0 || (size_t)written >= remaining) break;
+            p += written;
+            remaining -= written;
+            written = format_cycle_stats(p, remaining, &state->cycles, state->packets_received, false);
+            if (written < 0) {
+                p = record;                 // Drop the half-written record
+                remaining = sizeof(stats_json) - (p - stats_json);
+                break;
+            }
+            p += written;
+            remaining -= written;
+            count++;
+        }
+        
+        snprintf(p, remaining,
+                "],"
+                "\"packets_sent\":%lu,"
+                "\"bytes_sent\":%lu,"
+                "\"packets_received\":%lu,"
+                "\"bytes_received\":%lu,"
+                "\"out_of_order\":%lu,"
+                "\"duplicates\":%lu,"
+                "\"late_arrivals\":%lu,"
+                "\"lost_packets\":%lu,"
+                "\"latency_min_ns\":%lu,"
+                "\"latency_avg_ns\":%lu,"
+                "\"latency_max_ns\":%lu,"
+                "\"rx_clock\":\"%s\","
+                "\"microburst_count\":%lu,"
+                "\"microburst_max_duration_ns\":%lu,"
+                "\"tx_rate_mbps\":%.2f,"
+                "\"rx_rate_mbps\":%.2f,"
+                "\"throughput_mbps\":%.2f"
+                "}}\n",
+                total_tx, total_bytes,
+                rx_totals.packets_received, rx_totals.bytes_received,
+                rx_totals.out_of_order, rx_totals.duplicates,
+                rx_totals.late_arrivals, rx_totals.lost_packets,
+                rx_totals.min_latency_ns,
+                rx_totals.latency_count ? rx_totals.sum_latency_ns / rx_totals.latency_count : 0,
+                rx_totals.max_latency_ns,
+                rx_hw_timestamp ? "nic" : "tsc",
+                microburst.count, microburst.max_duration_ns,
+                tx_rate_mbps, rx_rate_mbps, tx_rate_mbps);
+        
+        control_send(client_sock, stats_json, strlen(stats_json));
+        
+    } else if (strcmp(command, "flows") == 0) {
+        // Flow coverage: flows seen vs. flows the profiles generate, plus a
+        // bounded list of per-flow counters
+        unsigned limit = 100;
+        struct json_object *val;
+        if (json_object_object_get_ex(root, "limit", &val)) {
+            limit = RTE_MIN((unsigned)json_object_get_int(val), 1000u);
+        }
+        
+        uint64_t expected_flows = 0;
+        for (int i = 0; i < num_profiles; i++) {
+            expected_flows += profiles[i].protocol == PROTO_ICMP ? 1 :
+                              (uint64_t)(profiles[i].src_port_max - profiles[i].src_port_min + 1);
+        }
+        
+        static char flows_json[262144];
+        char *p = flows_json;
+        size_t remaining = sizeof(flows_json);
+        int written = snprintf(p, remaining, "{\"status\":\"success\",\"data\":{\"flows\":[");
+        p += written;
+        remaining -= written;
+        
+        uint64_t flows_seen = 0, table_full = 0, min_packets = 0, max_packets = 0;
+        unsigned listed = 0;
+        bool list_full = false;
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            rx_lcore_state *state = lcore_confs[lcore_id].rx;
+            if (!state || !state->flows) continue;
+            
+            table_full += state->flow_table_full;
+            for (unsigned f = 0; f < flow_table_entries; f++) {
+                const flow_entry *fe = &state->flows[f];
+                if (fe->packets == 0) continue;
+                
+                if (flows_seen == 0 || fe->packets < min_packets) min_packets = fe->packets;
+                max_packets = RTE_MAX(max_packets, fe->packets);
+                flows_seen++;
+                
+                if (listed < limit && !list_full && remaining > 256) {
+                    uint32_t sip = rte_be_to_cpu_32(fe->key.src_ip);
+                    uint32_t dip = rte_be_to_cpu_32(fe->key.dst_ip);
+                    written = snprintf(p, remaining,
+                            "%s{\"src\":\"%u.%u.%u.%u:%u\",\"dst\":\"%u.%u.%u.%u:%u\","
+                            "\"proto\":%u,\"vlan\":%u,\"packets\":%lu,\"bytes\":%lu}",
+                            listed > 0 ? "," : "",
+                            sip >> 24, (sip >> 16) & 0xFF, (sip >> 8) & 0xFF, sip & 0xFF,
+                            rte_be_to_cpu_16(fe->key.src_port),
+                            dip >> 24, (dip >> 16) & 0xFF, (dip >> 8) & 0xFF, dip & 0xFF,
+                            rte_be_to_cpu_16(fe->key.dst_port),
+                            fe->key.proto, fe->key.vlan_id, fe->packets, fe->bytes);
+                    if (written < 0 || (size_t)written >= remaining) {
+                        list_full = true;   // Stop listing; keep counting
+                        continue;
+                    }
+                    p += written;
+                    remaining -= written;
+                    listed++;
+                }
+            }
+        }
+        
+        snprintf(p, remaining,
+                "],\"enabled\":%s,\"flows_seen\":%lu,\"expected_flows\":%lu,"
+                "\"min_packets_per_flow\":%lu,\"max_packets_per_flow\":%lu,"
+                "\"table_full_drops\":%lu}}\n",
+                flow_table_entries > 0 ? "true" : "false",
+                flows_seen, expected_flows, min_packets, max_packets, table_full);
+        control_send(client_sock, flows_json, strlen(flows_json));
+        
+    } else if (strcmp(command, "sketches") == 0) {
+        // Merge the per-queue sketches: HLL max, Count-Min sum, top-K union
+        static flow_sketch merged;
+        topk_entry candidates[TOPK_SIZE * 8];
+        unsigned num_candidates = 0;
+        
+        memset(&merged, 0, sizeof(merged));
+        for (unsigned lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+            rx_lcore_state *state = lcore_confs[lcore_id].rx;
+            if (!state || !state->sketch) continue;
+            
+            const flow_sketch *sk = state->sketch;
+            for (uint32_t r = 0; r < HLL_REGISTERS; r++) {
+                merged.hll[r] = RTE_MAX(merged.hll[r], sk->hll[r]);
+            }
+            for (uint32_t d = 0; d < CMS_DEPTH; d++) {
+                for (uint32_t w = 0; w < CMS_WIDTH; w++) merged.cms[d][w] += sk->cms[d][w];
+            }
+            for (uint32_t k = 0; k < TOPK_SIZE && num_candidates < RTE_DIM(candidates); k++) {
+                if (sk->topk[k].estimate > 0) candidates[num_candidates++] = sk->topk[k];
+            }
+            merged.packets += sk->packets;
+        }
+        
+        // HyperLogLog estimate with small-range (linear counting) correction
+        double m = HLL_REGISTERS, sum = 0;
+        unsigned zeros = 0;
+        for (uint32_t r = 0; r < HLL_REGISTERS; r++) {
+            sum += ldexp(1.0, -merged.hll[r]);
+            zeros += merged.hll[r] == 0;
+        }
+        double distinct = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        if (distinct <= 2.5 * m && zeros > 0) distinct = m * log(m / zeros);
+        if (merged.packets == 0) distinct = 0;
+        
+        // Re-estimate candidates against the merged counters, largest first
+        for (unsigned c = 0; c < num_candidates; c++) {
+            candidates[c].estimate = cms_estimate(merged.cms, flow_hash64(&candidates[c].key));
+        }
+        std::sort(candidates, candidates + num_candidates,
+                  [](const topk_entry &a, const topk_entry &b) { return a.estimate > b.estimate; });
+        
+        char sk_json[16384];
+        char *p = sk_json;
+        size_t remaining = sizeof(sk_json);
+        int written = snprintf(p, remaining,
+                "{\"status\":\"success\",\"data\":{\"enabled\":%s,"
+                "\"packets\":%lu,\"distinct_flows\":%.0f,"
+                "\"hll_std_error_pct\":%.2f,\"cms_max_overestimate\":%.0f,"
+                "\"heavy_hitters\":[",
+                flow_sketches_enabled ? "true" : "false",
+                merged.packets, distinct, 104.0 / sqrt(m),
+                2.718281828 / CMS_WIDTH * merged.packets);
+        p += written;
+        remaining -= written;
+        
+        unsigned listed = 0;
+        for (unsigned c = 0; c < num_candidates && listed < TOPK_SIZE && remaining > 256; c++) {
+            // Different queues never hold the same flow, but skip exact repeats
+            bool repeat = false;
+            for (unsigned prev = 0; prev < c; prev++) {
+                if (memcmp(&candidates[prev].key, &candidates[c].key, sizeof(flow_key)) == 0) repeat = true;
+            }
+            if (repeat) continue;
+            
+            const flow_key *key = &candidates[c].key;
+            uint32_t sip = rte_be_to_cpu_32(key->src_ip);
+            uint32_t dip = rte_be_to_cpu_32(key->dst_ip);
+            written = snprintf(p, remaining,
+                    "%s{\"src\":\"%u.%u.%u.%u:%u\",\"dst\":\"%u.%u.%u.%u:%u\","
+                    "\"proto\":%u,\"vlan\":%u,\"packets_est\":%lu}",
+                    listed > 0 ? "," : "",
+                    sip >> 24, (sip >> 16) & 0xFF, (sip >> 8) & 0xFF, sip & 0xFF,
+                    rte_be_to_cpu_16(key->src_port),
+                    dip >> 24, (dip >> 16) & 0xFF, (dip >> 8) & 0xFF, dip & 0xFF,
+                    rte_be_to_cpu_16(key->dst_port),
+                    key->proto, key->vlan_id, candidates[c].estimate);
+            if (written < 0 || (size_t)written >= remaining) break;
+            p += written;
+            remaining -= written;
+            listed++;
+        }
+        
+        snprintf(p, remaining, "]}}\n");
+        control_send(client_sock, sk_json, strlen(sk_json));
+        
+    } else if (strcmp(command, "microburst") == 0) {
+        // Optional reconfiguration (applies at next start), then the event log
+        struct json_object *val;
+        if (json_object_object_get_ex(root, "bucket_us", &val) && json_object_get_int(val) > 0) {
+            microburst_cfg.bucket_us = json_object_get_int(val);
+        }
+        if (json_object_object_get_ex(root, "threshold_pct", &val) &&
+            json_object_get_int(val) > 0 && json_object_get_int(val) <= 100) {
+            microburst_cfg.threshold_pct = json_object_get_int(val);
+        }
+        
+        char mb_json[32768];
+        char *p = mb_json;
+        size_t remaining = sizeof(mb_json);
+        int written = snprintf(p, remaining,
+                "{\"status\":\"success\",\"data\":{"
+                "\"bucket_us\":%u,\"threshold_pct\":%u,"
+                "\"microburst_count\":%lu,\"microburst_max_duration_ns\":%lu,"
+                "\"events\":[",
+                microburst_cfg.bucket_us, microburst_cfg.threshold_pct,
+                microburst.count, microburst.max_duration_ns);
+        p += written;
+        remaining -= written;
+        
+        uint64_t head = microburst.log_head;
+        uint64_t first = head > MICROBURST_LOG_SIZE ? head - MICROBURST_LOG_SIZE : 0;
+        for (uint64_t e = first; e < head && remaining > 256; e++) {
+            const microburst_event *ev = &microburst.log[e % MICROBURST_LOG_SIZE];
+            written = snprintf(p, remaining,
+                    "%s{\"start_ns\":%lu,\"duration_ns\":%lu,\"peak_bytes\":%lu,\"peak_pct\":%u}",
+                    e > first ? "," : "", ev->start_ns, ev->duration_ns,
+                    ev->peak_bytes, ev->peak_pct);
+            if (written < 0 || (size_t)written >= remaining) break;
+            p += written;
+            remaining -= written;
+        }
+        
+        snprintf(p, remaining, "]}}\n");
+        control_send(client_sock, mb_json, strlen(mb_json));
+        
+    } else if (!test_runner_command(client_sock, command, root)) {
+        const char *error = "{\"status\":\"error\",\"message\":\"Unknown command\"}\n";
+        control_send(client_sock, error, strlen(error));
+    }
+    
+    json_object_put(root);
+}
+
+// Control socket thread
+// Handle every complete message buffered for a client.
+// Returns false if the client sent something unparseable and must be dropped.
+static bool control_process(int fd, control_client *client) {
+    std::string &buf = client->rx_buf;
+    
+    if (client->framing == CONTROL_FRAMING_UNKNOWN && !buf.empty()) {
+        size_t first = buf.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) return true;
+        client->framing = buf[first] == '{' ? CONTROL_FRAMING_LINE : CONTROL_FRAMING_LENGTH;
+    }
+    
+    while (!buf.empty()) {
+        std::string msg;
+        
+        if (client->framing == CONTROL_FRAMING_LENGTH) {
+            if (buf.size() < sizeof(uint32_t)) break;
+            uint32_t be_len;
+            memcpy(&be_len, buf.data(), sizeof(be_len));
+            uint32_t len = ntohl(be_len);
+            if (len > CONTROL_MAX_MESSAGE) return false;
+            if (buf.size() < sizeof(uint32_t) + len) break;
+            msg = buf.substr(sizeof(uint32_t), len);
+            buf.erase(0, sizeof(uint32_t) + len);
+        } else {
+            size_t eol = buf.find('\n');
+            if (eol == std::string::npos) {
+                // Older clients send one JSON object without a newline
+                if (buf.back() != '}') break;
+                struct json_object *probe = json_tokener_parse(buf.c_str());
+                if (!probe) break;
+                json_object_put(probe);
+                eol = buf.size();
+            }
+            msg = buf.substr(0, eol);
+            buf.erase(0, RTE_MIN(eol + 1, buf.size()));
+            if (msg.find_first_not_of(" \t\r") == std::string::npos) continue;
+        }
+        
+        handle_control_command(fd, msg.c_str());
+        if (client->watcher) break;     // Anything after rfc2544_watch is ignored
+    }
+    
+    return buf.size() <= CONTROL_MAX_MESSAGE + sizeof(uint32_t);
+}
+
+static void control_close(int epfd, int fd) {
+    if (fd == start_waiter) start_waiter = -1;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    control_clients.erase(fd);
+    close(fd);
+}
+
+// The connection now belongs to the RFC 2544 watcher list, which closes it
+static void control_detach(int epfd, int fd) {
+    if (fd == start_waiter) start_waiter = -1;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    control_clients.erase(fd);
+}
+
+void* control_socket_thread(void *arg) {
+    const char *socket_path = (const char*)arg;
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    
+    unlink(socket_path);
+    
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        perror("bind");
+        return NULL;
+    }
+    
+    listen(sock, 16);
+    
+    int epfd = epoll_create1(0);
+    if (epfd == -1) {
+        perror("epoll_create1");
+        close(sock);
+        return NULL;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = sock;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev);
+    
+    printf("Control socket listening on %s\n", socket_path);
+    
+    struct epoll_event events[16];
+    static char buffer[65536];
+    
+    while (!force_quit) {
+        int nfds = epoll_wait(epfd, events, RTE_DIM(events), start_pending ? 10 : 100);
+        control_start_poll();
+        
+        for (int i = 0; i < nfds; i++) {
+            int fd = events[i].data.fd;
+            
+            if (fd == sock) {
+                int client;
+                while ((client = accept(sock, NULL, NULL)) >= 0) {
+                    if (control_clients.size() >= CONTROL_MAX_CLIENTS) {
+                        close(client);
+                        continue;
+                    }
+                    // Replies are written in one go; bound how long a stuck client can stall us
+                    struct timeval tv = {CONTROL_SEND_TIMEOUT_MS / 1000, (CONTROL_SEND_TIMEOUT_MS % 1000) * 1000};
+                    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+                    
+                    ev.events = EPOLLIN | EPOLLRDHUP;
+                    ev.data.fd = client;
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, client, &ev);
+                    control_clients[client] = control_client();
+                }
+                continue;
+            }
+            
+            auto it = control_clients.find(fd);
+            if (it == control_clients.end()) continue;
+            
+            bool keep = true;
+            while (keep) {
+                ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                if (n > 0) {
+                    it->second.rx_buf.append(buffer, n);
+                } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    keep = false;
+                } else {
+                    break;
+                }
+            }
+            
+            // A client may half-close after its last command; still answer it
+            bool ok = control_process(fd, &it->second);
+            if (it->second.watcher) {
+                control_detach(epfd, fd);
+            } else if (!ok || !keep) {
+                control_close(epfd, fd);
+            }
+        }
+    }
+    
+    while (!control_clients.empty()) {
+        control_close(epfd, control_clients.begin()->first);
+    }
+    close(epfd);
+    close(sock);
+    unlink(socket_path);
+    return NULL;
+}
+
+// Main
+int main(int argc, char *argv[]) {
+    signal(SIGINT, [](int){force_quit = true;});
+    signal(SIGTERM, [](int){force_quit = true;});
+    
+    const char *control_socket = "/tmp/dpdk_engine_control.sock";
+    
+    // Initialize DPDK
+    int ret = rte_eal_init(argc, argv);
+    if (ret < 0) {
+        fprintf(stderr, "Failed to initialize DPDK\n");
+        return -1;
+    }
+    argc -= ret;
+    argv += ret;
+    
+    // Tools attach as secondaries; the engine itself must own the ports
+    if (rte_eal_process_type() != RTE_PROC_PRIMARY) {
+        fprintf(stderr, "The engine must run as the DPDK primary process\n");
+        return -1;
+    }
+    
+    tsc_ns_fp = (uint64_t)(((unsigned __int128)1000000000ULL << 32) / rte_get_tsc_hz());
+    
+    // Application options (after --)
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rx-queues") == 0 && i + 1 < argc) {
+            rx_queues_requested = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--flow-table") == 0 && i + 1 < argc) {
+            flow_table_entries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sketches") == 0) {
+            flow_sketches_enabled = true;
+        } else if (strcmp(argv[i], "--stats-hz") == 0 && i + 1 < argc) {
+            stats_publish_hz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timeseries-us") == 0 && i + 1 < argc) {
+            timeseries_us_requested = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metrics_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-arp") == 0) {
+            arp_enabled = false;
+        } else if (strcmp(argv[i], "--lldp-interval") == 0 && i + 1 < argc) {
+            lldp_interval_sec = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--numa-strict") == 0) {
+            numa_strict = true;
+        } else if (strcmp(argv[i], "--rxd") == 0 && i + 1 < argc) {
+            rxd_requested = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--txd") == 0 && i + 1 < argc) {
+            txd_requested = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mbufs") == 0 && i + 1 < argc) {
+            mbufs_requested = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mbuf-cache") == 0 && i + 1 < argc) {
+            mbuf_cache_size = atoi(argv[++i]);
+        }
+    }
+    
+    // Check ports
+    uint16_t nb_ports = rte_eth_dev_count_avail();
+    printf("Found %u DPDK ports\n", nb_ports);
+    
+    if (nb_ports == 0) {
+        fprintf(stderr, "No DPDK ports available\n");
+        return -1;
+    }
+    
+    tx_port = 0;
+    dual_port_mode = (nb_ports >= 2);
     if (dual_port_mode) {
         rx_port = 1;
         printf("Dual-port mode: TX on port %d, RX on port %d\n", tx_port, rx_port);
@@ -513,33 +6131,81 @@ int main(int argc, char *argv[]) {
         printf("Single-port mode: TX only on port %d\n", tx_port);
     }
     
-    // Create mbuf pool
-    mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", NUM_MBUFS,
-                                       MBUF_CACHE_SIZE, 0,
-                                       RTE_MBUF_DEFAULT_BUF_SIZE,
-                                       rte_socket_id());
-    if (!mbuf_pool) {
-        fprintf(stderr, "Failed to create mbuf pool\n");
+    // Lcore roles decide how many queues each port needs
+    if (assign_lcore_roles() != 0) {
+        return -1;
+    }
+    
+    // Queues and descriptors; the ARP resolver gets RX queue 0 and one
+    // extra TX queue on tx_port
+    arp_tx_queue = num_tx_lcores;
+    if (plan_port(tx_port, arp_enabled ? 1 : 0, num_tx_lcores + (arp_enabled ? 1 : 0)) != 0 ||
+        (dual_port_mode && plan_port(rx_port, RTE_MAX(num_rx_lcores, 1u), 1) != 0)) {
+        return -1;
+    }
+    
+    // Mbuf pools next to the NICs, sized for what the queues and lcores hold
+    if (create_socket_pools() != 0) {
         return -1;
     }
     
     // Initialize ports
-    if (init_port(tx_port, mbuf_pool, false) != 0) {
+    if (init_port(tx_port, port_pool(tx_port)) != 0) {
         fprintf(stderr, "Failed to initialize TX port\n");
         return -1;
     }
     
     if (dual_port_mode) {
-        if (init_port(rx_port, mbuf_pool, true) != 0) {
+        if (init_port(rx_port, port_pool(rx_port)) != 0) {
             fprintf(stderr, "Failed to initialize RX port\n");
             return -1;
         }
     }
     
+    register_telemetry();
+    
+    // ARP resolver and responder; it also serves the secondary processes
+    pthread_t arp_tid;
+    bool arp_started = false;
+    if (arp_enabled) {
+        arp_ring = rte_ring_create("arp_ring", ARP_RING_SIZE, rte_socket_id(), RING_F_SC_DEQ);
+        if (!arp_ring) {
+            fprintf(stderr, "Failed to create ARP ring\n");
+            return -1;
+        }
+        if (mp_init(control_socket) != 0) {
+            return -1;
+        }
+        if (dpdk_discovery_init(0, port_socket(tx_port)) != 0) {
+            return -1;
+        }
+        arp_started = pthread_create(&arp_tid, NULL, arp_resolver_thread, NULL) == 0;
+    }
+    
     // Start control socket thread
     pthread_t control_thread;
     pthread_create(&control_thread, NULL, control_socket_thread, (void*)control_socket);
     
+    // Shared-memory statistics
+    pthread_t stats_thread;
+    bool stats_thread_started = false;
+    if (stats_publish_hz > 0 && stats_shm_create() == 0) {
+        stats_thread_started = pthread_create(&stats_thread, NULL, stats_publisher_thread, NULL) == 0;
+    }
+    
+    // Rate time series
+    pthread_t timeseries_tid;
+    bool timeseries_started = false;
+    if (timeseries_us_requested > 0 && timeseries_create() == 0) {
+        timeseries_interval_us = RTE_MAX(timeseries_us_requested, (unsigned)TIMESERIES_MIN_US);
+        timeseries_started = pthread_create(&timeseries_tid, NULL, timeseries_thread, NULL) == 0;
+    }
+    
+    // OpenMetrics exporter
+    pthread_t metrics_tid;
+    bool metrics_started = metrics_port > 0 &&
+                           pthread_create(&metrics_tid, NULL, metrics_thread, NULL) == 0;
+    
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════╗\n");
     printf("║  NetGen Pro - DPDK Engine (TX TIMING FIX APPLIED)         ║\n");
@@ -550,8 +6216,23 @@ int main(int argc, char *argv[]) {
     
     // Wait for control thread
     pthread_join(control_thread, NULL);
+    if (stats_thread_started) {
+        pthread_join(stats_thread, NULL);
+    }
+    if (timeseries_started) {
+        pthread_join(timeseries_tid, NULL);
+    }
+    if (metrics_started) {
+        pthread_join(metrics_tid, NULL);
+    }
+    if (arp_started) {
+        pthread_join(arp_tid, NULL);
+    }
     
     // Cleanup
+    dpdk_discovery_free();
+    mp_free();
+    stats_shm_destroy();
     rte_eal_cleanup();
     
     return 0;
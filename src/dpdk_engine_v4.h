@@ -21,11 +21,25 @@
 // ============================================================================
 
 // Multi-Core Scaling Configuration
+// Ring and pool sizes are defaults only: the engine picks descriptor counts
+// within the driver's limits (--rxd/--txd) and sizes each mempool from the
+// queues, descriptors and lcores that use it (--mbufs/--mbuf-cache).
 #define MAX_WORKER_CORES 16
-#define RX_RING_SIZE 4096      // Increased from 2048
-#define TX_RING_SIZE 4096
-#define NUM_MBUFS 32767        // Increased from 8191
+#ifndef RX_RING_SIZE
+#define RX_RING_SIZE 2048      // RX descriptors per queue
+#endif
+#ifndef TX_RING_SIZE
+#define TX_RING_SIZE 2048      // TX descriptors per queue
+#endif
+#ifndef NUM_MBUFS
+#define NUM_MBUFS 8191         // Smallest mempool (2^n - 1)
+#endif
+#ifndef MBUF_CACHE_SIZE
+#define MBUF_CACHE_SIZE 250    // Per-lcore mempool cache
+#endif
+#ifndef BURST_SIZE
 #define BURST_SIZE 64          // Optimal for performance
+#endif
 #define PREFETCH_OFFSET 3      // Prefetch packets ahead
 
 // NUMA Awareness
@@ -192,6 +206,10 @@ struct discovered_device {
     char system_name[128];
     char system_description[256];
     uint16_t capabilities;
+    uint16_t enabled_capabilities;
+    char chassis_id[64];
+    char port_id[64];
+    uint16_t ttl;                   // Seconds the neighbor stays valid
 };
 
 struct topology_info {
@@ -272,12 +290,22 @@ struct aggregate_stats {
 };
 
 // Enhanced RFC 2544 with multiple frame sizes
+// test_type is a mask of these
+enum rfc2544_test_type {
+    RFC2544_TEST_THROUGHPUT = 1 << 0,
+    RFC2544_TEST_LATENCY = 1 << 1,
+    RFC2544_TEST_FRAME_LOSS = 1 << 2,
+    RFC2544_TEST_BACK_TO_BACK = 1 << 3
+};
+
+#define RFC2544_MAX_FRAME_SIZES 8
+
 struct rfc2544_test_v4 {
     bool running;
     uint8_t test_type;
     
     // Multi-size testing
-    uint16_t frame_sizes[8];    // e.g., 64, 128, 256, 512, 1024, 1518
+    uint16_t frame_sizes[RFC2544_MAX_FRAME_SIZES];  // e.g., 64, 128, 256, 512, 1024, 1518
     uint8_t num_frame_sizes;
     uint8_t current_size_idx;
     
@@ -300,7 +328,7 @@ struct rfc2544_test_v4 {
         uint64_t jitter_ns;
         double loss_pct;
         bool passed;
-    } results[8];
+    } results[RFC2544_MAX_FRAME_SIZES];
     
     // Micro-burst detection
     uint32_t microburst_count;
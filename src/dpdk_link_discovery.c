@@ -6,30 +6,168 @@
  * 2. Port statistics (rte_eth_stats_get)
  * 3. Device info (rte_eth_dev_info_get)
  * 4. MAC address retrieval
- * 5. ARP-like discovery via packet inspection
+ * 5. ARP-like discovery via packet inspection (hash-indexed, 64K+ devices)
  */
 
 #include <rte_ethdev.h>
 #include <rte_ether.h>
 #include <rte_arp.h>
+#include <rte_hash.h>
+#include <rte_hash_crc.h>
+#include <rte_cycles.h>
+#include <rte_malloc.h>
+#include <rte_pause.h>
+#include <rte_spinlock.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 
-#define MAX_DISCOVERED_DEVICES 256
+#define DISCOVERY_DEFAULT_DEVICES 65536
 #define DISCOVERY_TIMEOUT_SEC 300  // 5 minutes
+#define DISCOVERY_EXPIRY_SLOTS 64  // Expiry wheel; a slot spans TIMEOUT / (SLOTS - 2)
+#define DISCOVERY_FREE_GRACE_US 1000  // RX lookups finish long before a slot is reused
 
-struct discovered_device {
+/*
+ * Discovered devices live in an rte_hash keyed by (port, MAC, IP); the
+ * entries array is indexed by the key position the hash returns. Lookups are
+ * lock-free, so RX lcores can call dpdk_inspect_packet_for_discovery() inline.
+ *
+ * Expiry uses a wheel of time slots. A new entry is pushed onto the slot of
+ * its creation time; refreshing only moves last_seen. Once a slot is older
+ * than the timeout, cleanup walks it and deletes the entries still idle and
+ * moves the others to the slot of their last_seen, so each entry is visited
+ * about once per timeout. Deleted positions are returned to the hash one
+ * grace period later, as an RX lcore may still be updating them.
+ */
+struct discovery_key {
     uint8_t mac_addr[RTE_ETHER_ADDR_LEN];
-    uint32_t ip_addr;
     uint16_t port_id;
-    time_t last_seen;
+    uint32_t ip_addr;
+} __attribute__((packed));
+
+// discovered_device.in_use: an RX lcore claims a fresh position with a CAS
+// from FREE to CLAIMED, fills it in and publishes it as READY
+enum {
+    DEVICE_FREE = 0,
+    DEVICE_READY = 1,
+    DEVICE_CLAIMED = 2
+};
+
+struct discovered_device {
+    struct discovery_key key;
+    volatile uint8_t in_use;        // DEVICE_*
+    uint32_t next;              // Expiry slot or free chain (position + 1, 0 ends)
+    uint64_t first_seen;        // TSC
+    volatile uint64_t last_seen;  // TSC
     uint64_t packet_count;
     char device_type[32];
 };
 
-static struct discovered_device discovered_devices[MAX_DISCOVERED_DEVICES];
-static int num_discovered = 0;
+static struct rte_hash *discovery_hash;
+static struct discovered_device *discovered_devices;  // Indexed by key position
+static uint32_t discovery_max_positions;
+static uint32_t num_discovered;
+static uint64_t discovery_table_full;  // ARP senders that did not fit
+
+static uint32_t expiry_slots[DISCOVERY_EXPIRY_SLOTS];  // Chain heads (position + 1)
+static uint64_t expiry_slot_cycles;
+static uint64_t expiry_next_slot;       // Oldest slot not yet walked
+static uint32_t pending_free;           // Deleted positions awaiting the grace period
+static uint64_t pending_free_tsc;
+static rte_spinlock_t discovery_cleanup_lock = RTE_SPINLOCK_INITIALIZER;
+
+// TSC <-> wall clock for reporting
+static uint64_t discovery_tsc_base;
+static time_t discovery_time_base;
+
+#define SCAN_BURST 32
+#define SCAN_DEFAULT_PPS 100000       // A /16 in under a second
+#define SCAN_MIN_PREFIX 8
+#define SCAN_REPLY_WAIT_MS 1000       // Late replies still counted after the last probe
+
+enum scan_state {
+    SCAN_IDLE = 0,
+    SCAN_SENDING,
+    SCAN_WAITING,
+    SCAN_DONE,
+    SCAN_ABORTED,
+    SCAN_STARTING                   // Being re-armed; readers keep off
+};
+
+/*
+ * Subnet sweep. The control path arms it with dpdk_scan_subnet_start(); the
+ * lcore that owns the TX queue calls dpdk_scan_subnet_poll() from its loop,
+ * which sends the probes that are due in bursts. Replies are matched by
+ * dpdk_inspect_packet_for_discovery() on the RX path against a bitmap of
+ * target hosts.
+ *
+ * The RX path and the poller hold a reference (scan_refs) while they use the
+ * sweep. A restart first moves the state to SCAN_STARTING, which new readers
+ * back off from, and waits for the references to drain before it frees the
+ * bitmap and rewrites the sweep. All state changes are compare-and-swap, so
+ * an abort is never overwritten by the poller.
+ */
+struct subnet_scan {
+    volatile int state;             // enum scan_state
+    uint16_t port_id;
+    uint16_t queue_id;
+    struct rte_mempool *pool;
+    uint8_t probe[sizeof(struct rte_ether_hdr) + sizeof(struct rte_arp_hdr)];
+    uint32_t first_host;            // Host order
+    uint32_t num_hosts;
+    uint32_t next_host;             // Index of the next target
+    uint32_t rate_pps;
+    uint64_t probe_cycles;          // TSC cycles between probes
+    uint64_t next_tsc;              // Deadline of the next probe
+    uint64_t start_tsc;
+    uint64_t sent_tsc;              // Last probe sent
+    uint64_t end_tsc;
+    uint64_t probes_sent;
+    uint64_t tx_failures;           // Probes dropped (no mbuf or TX queue full)
+    uint64_t *replied;              // One bit per target host
+    uint32_t hosts_found;
+};
+
+static struct subnet_scan scan;
+static uint32_t scan_refs;          // RX lcores and poller inside the sweep
+
+// Take a reference and return the state; a restart waits for it to be put
+static inline int scan_get(void)
+{
+    __atomic_fetch_add(&scan_refs, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&scan.state, __ATOMIC_SEQ_CST);
+}
+
+static inline void scan_put(void)
+{
+    __atomic_fetch_sub(&scan_refs, 1, __ATOMIC_RELEASE);
+}
+
+// Move the sweep from one state to another; fails if it changed meanwhile
+static inline int scan_transition(int from, int to)
+{
+    return __atomic_compare_exchange_n(&scan.state, &from, to, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+// Mark a target host as answered (RX path)
+static inline void scan_match_reply(uint16_t port_id, uint32_t sender_ip)
+{
+    int state = scan_get();
+    if (state != SCAN_SENDING && state != SCAN_WAITING) {
+        scan_put();
+        return;
+    }
+    
+    uint32_t index = rte_be_to_cpu_32(sender_ip) - scan.first_host;
+    if (port_id == scan.port_id && index < scan.num_hosts) {
+        uint64_t bit = 1ULL << (index & 63);
+        if (!(__atomic_fetch_or(&scan.replied[index >> 6], bit, __ATOMIC_RELAXED) & bit)) {
+            __atomic_fetch_add(&scan.hosts_found, 1, __ATOMIC_RELAXED);
+        }
+    }
+    scan_put();
+}
 
 /*
  * Get link status for a DPDK port
@@ -133,9 +271,81 @@ const char* dpdk_get_link_speed_str(uint32_t speed)
     }
 }
 
+/*
+ * Create the discovered-device table
+ * max_devices: capacity (0 = DISCOVERY_DEFAULT_DEVICES)
+ * Returns: 0 on success, -1 on error
+ */
+int dpdk_discovery_init(uint32_t max_devices, int socket_id)
+{
+    if (discovery_hash) {
+        return 0;
+    }
+    if (max_devices == 0) {
+        max_devices = DISCOVERY_DEFAULT_DEVICES;
+    }
+    
+    struct rte_hash_parameters params = {0};
+    params.name = "discovered_devices";
+    params.entries = max_devices;
+    params.key_len = sizeof(struct discovery_key);
+    params.hash_func = rte_hash_crc;
+    params.hash_func_init_val = 0;
+    params.socket_id = socket_id;
+    params.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF |
+                        RTE_HASH_EXTRA_FLAGS_MULTI_WRITER_ADD |
+                        RTE_HASH_EXTRA_FLAGS_EXT_TABLE;
+    
+    discovery_hash = rte_hash_create(&params);
+    if (!discovery_hash) {
+        fprintf(stderr, "Failed to create discovery table (%u devices)\n", max_devices);
+        return -1;
+    }
+    
+    // Per-lcore key caches can hand out positions above 'entries'
+    discovery_max_positions = (uint32_t)rte_hash_max_key_id(discovery_hash) + 1;
+    discovered_devices = rte_zmalloc_socket("discovered_devices",
+                                            (size_t)discovery_max_positions *
+                                            sizeof(struct discovered_device),
+                                            RTE_CACHE_LINE_SIZE, socket_id);
+    if (!discovered_devices) {
+        fprintf(stderr, "Failed to allocate %u discovery entries\n", discovery_max_positions);
+        rte_hash_free(discovery_hash);
+        discovery_hash = NULL;
+        return -1;
+    }
+    
+    discovery_tsc_base = rte_rdtsc();
+    discovery_time_base = time(NULL);
+    expiry_slot_cycles = rte_get_tsc_hz() * DISCOVERY_TIMEOUT_SEC / (DISCOVERY_EXPIRY_SLOTS - 2);
+    expiry_next_slot = discovery_tsc_base / expiry_slot_cycles;
+    
+    printf("Discovery table: %u devices\n", max_devices);
+    return 0;
+}
+
+void dpdk_discovery_free(void)
+{
+    rte_hash_free(discovery_hash);
+    rte_free(discovered_devices);
+    discovery_hash = NULL;
+    discovered_devices = NULL;
+    num_discovered = 0;
+}
+
+// Push a position onto a chain (RX lcores push concurrently)
+static inline void discovery_chain_push(uint32_t *head, uint32_t pos)
+{
+    uint32_t old = __atomic_load_n(head, __ATOMIC_RELAXED);
+    do {
+        discovered_devices[pos].next = old;
+    } while (!__atomic_compare_exchange_n(head, &old, pos + 1, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
 /*
  * Inspect ARP packets to discover devices
- * Call this for each received packet
+ * Call this for each received packet (safe from several RX lcores)
  */
 void dpdk_inspect_packet_for_discovery(uint16_t port_id, struct rte_mbuf *pkt)
 {
@@ -148,6 +358,10 @@ void dpdk_inspect_packet_for_discovery(uint16_t port_id, struct rte_mbuf *pkt)
     if (eth_hdr->ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP)) {
         return;
     }
+    if (unlikely(!discovery_hash ||
+                 rte_pktmbuf_data_len(pkt) < sizeof(*eth_hdr) + sizeof(*arp_hdr))) {
+        return;
+    }
     
     arp_hdr = (struct rte_arp_hdr *)(eth_hdr + 1);
     
@@ -157,70 +371,140 @@ void dpdk_inspect_packet_for_discovery(uint16_t port_id, struct rte_mbuf *pkt)
         return;
     }
     
-    // Extract source MAC and IP
-    uint8_t src_mac[RTE_ETHER_ADDR_LEN];
-    uint32_t src_ip;
+    // Source MAC and IP identify the device
+    struct discovery_key key;
+    memcpy(key.mac_addr, arp_hdr->arp_data.arp_sha.addr_bytes, RTE_ETHER_ADDR_LEN);
+    key.port_id = port_id;
+    key.ip_addr = arp_hdr->arp_data.arp_sip;
     
-    memcpy(src_mac, arp_hdr->arp_data.arp_sha.addr_bytes, RTE_ETHER_ADDR_LEN);
-    src_ip = arp_hdr->arp_data.arp_sip;
+    scan_match_reply(port_id, key.ip_addr);
     
-    // Check if we already know this device
-    int found = -1;
-    for (int i = 0; i < num_discovered; i++) {
-        if (memcmp(discovered_devices[i].mac_addr, src_mac, RTE_ETHER_ADDR_LEN) == 0) {
-            found = i;
-            break;
-        }
-    }
+    uint64_t now = rte_rdtsc();
+    uint32_t sig = rte_hash_hash(discovery_hash, &key);
+    int32_t pos = rte_hash_lookup_with_hash(discovery_hash, &key, sig);
     
-    if (found >= 0) {
+    if (likely(pos >= 0)) {
         // Update existing device
-        discovered_devices[found].last_seen = time(NULL);
-        discovered_devices[found].packet_count++;
-    } else if (num_discovered < MAX_DISCOVERED_DEVICES) {
-        // Add new device
-        memcpy(discovered_devices[num_discovered].mac_addr, src_mac, RTE_ETHER_ADDR_LEN);
-        discovered_devices[num_discovered].ip_addr = src_ip;
-        discovered_devices[num_discovered].port_id = port_id;
-        discovered_devices[num_discovered].last_seen = time(NULL);
-        discovered_devices[num_discovered].packet_count = 1;
-        snprintf(discovered_devices[num_discovered].device_type, 32, "Unknown");
-        
-        printf("Discovered new device on port %u: %02x:%02x:%02x:%02x:%02x:%02x IP: %u.%u.%u.%u\n",
-               port_id,
-               src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
-               (src_ip >> 0) & 0xFF, (src_ip >> 8) & 0xFF,
-               (src_ip >> 16) & 0xFF, (src_ip >> 24) & 0xFF);
-        
-        num_discovered++;
+        struct discovered_device *dev = &discovered_devices[pos];
+        dev->last_seen = now;
+        __atomic_fetch_add(&dev->packet_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    pos = rte_hash_add_key_with_hash(discovery_hash, &key, sig);
+    if (pos < 0) {
+        __atomic_fetch_add(&discovery_table_full, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    // Lcores adding the same key get the same position; only the one that
+    // claims it initialises the entry and links it into the expiry wheel
+    struct discovered_device *dev = &discovered_devices[pos];
+    uint8_t expected = DEVICE_FREE;
+    __atomic_fetch_add(&dev->packet_count, 1, __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&dev->in_use, &expected, DEVICE_CLAIMED, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        dev->last_seen = now;
+        return;
     }
+    
+    // Add new device
+    dev->key = key;
+    dev->first_seen = now;
+    dev->last_seen = now;
+    snprintf(dev->device_type, sizeof(dev->device_type), "Unknown");
+    __atomic_store_n(&dev->in_use, DEVICE_READY, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&num_discovered, 1, __ATOMIC_RELAXED);
+    discovery_chain_push(&expiry_slots[(now / expiry_slot_cycles) % DISCOVERY_EXPIRY_SLOTS], pos);
+    
+    RTE_LOG_DP(DEBUG, USER1,
+               "Discovered new device on port %u: %02x:%02x:%02x:%02x:%02x:%02x IP: %u.%u.%u.%u\n",
+               port_id,
+               key.mac_addr[0], key.mac_addr[1], key.mac_addr[2],
+               key.mac_addr[3], key.mac_addr[4], key.mac_addr[5],
+               (key.ip_addr >> 0) & 0xFF, (key.ip_addr >> 8) & 0xFF,
+               (key.ip_addr >> 16) & 0xFF, (key.ip_addr >> 24) & 0xFF);
 }
 
 /*
  * Clean up stale discovered devices (not seen in DISCOVERY_TIMEOUT_SEC)
+ * Only walks the expiry slots that aged out since the last call
  */
 void dpdk_cleanup_discovered_devices(void)
 {
-    time_t now = time(NULL);
-    int i = 0;
-    
-    while (i < num_discovered) {
-        if (now - discovered_devices[i].last_seen > DISCOVERY_TIMEOUT_SEC) {
-            // Remove this device by shifting array
-            memmove(&discovered_devices[i], 
-                   &discovered_devices[i + 1],
-                   (num_discovered - i - 1) * sizeof(struct discovered_device));
-            num_discovered--;
-        } else {
-            i++;
+    if (!discovery_hash) {
+        return;
+    }
+    
+    rte_spinlock_lock(&discovery_cleanup_lock);
+    
+    uint64_t now = rte_rdtsc();
+    uint64_t timeout = rte_get_tsc_hz() * DISCOVERY_TIMEOUT_SEC;
+    uint64_t cur_slot = now / expiry_slot_cycles;
+    
+    // Release positions deleted by an earlier call
+    if (pending_free && now - pending_free_tsc > rte_get_tsc_hz() / 1000000 * DISCOVERY_FREE_GRACE_US) {
+        while (pending_free) {
+            uint32_t pos = pending_free - 1;
+            pending_free = discovered_devices[pos].next;
+            rte_hash_free_key_with_position(discovery_hash, pos);
+        }
+    }
+    
+    // A slot holds last_seen values older than the timeout once it is
+    // SLOTS - 1 slots behind the current one
+    uint32_t deleted = 0;
+    while (expiry_next_slot + DISCOVERY_EXPIRY_SLOTS - 1 <= cur_slot) {
+        uint32_t *head = &expiry_slots[expiry_next_slot % DISCOVERY_EXPIRY_SLOTS];
+        uint32_t chain = __atomic_exchange_n(head, 0, __ATOMIC_ACQUIRE);
+        
+        while (chain) {
+            uint32_t pos = chain - 1;
+            struct discovered_device *dev = &discovered_devices[pos];
+            chain = dev->next;
+            
+            uint64_t last_seen = dev->last_seen;
+            if (now - last_seen <= timeout) {
+                discovery_chain_push(&expiry_slots[(last_seen / expiry_slot_cycles) %
+                                                   DISCOVERY_EXPIRY_SLOTS], pos);
+                continue;
+            }
+            
+            rte_hash_del_key(discovery_hash, &dev->key);
+            dev->packet_count = 0;
+            __atomic_store_n(&dev->in_use, DEVICE_FREE, __ATOMIC_RELEASE);
+            dev->next = pending_free;
+            pending_free = pos + 1;
+            deleted++;
         }
+        expiry_next_slot++;
+    }
+    
+    if (deleted) {
+        pending_free_tsc = now;
+        __atomic_fetch_sub(&num_discovered, deleted, __ATOMIC_RELAXED);
     }
+    
+    rte_spinlock_unlock(&discovery_cleanup_lock);
+}
+
+/*
+ * Table occupancy: devices currently known and ARP senders dropped because
+ * the table was full
+ */
+void dpdk_discovery_stats(uint32_t *devices, uint64_t *table_full)
+{
+    *devices = __atomic_load_n(&num_discovered, __ATOMIC_RELAXED);
+    *table_full = __atomic_load_n(&discovery_table_full, __ATOMIC_RELAXED);
 }
 
 /*
- * Get all discovered devices for a specific port as JSON
+ * Get the discovered devices for a specific port as JSON, starting at the
+ * offset-th one (in table order) and stopping after 'limit' devices or
+ * when the buffer is nearly full
  */
-int dpdk_get_discovered_devices(uint16_t port_id, char *json_buffer, size_t buf_size)
+int dpdk_get_discovered_devices(uint16_t port_id, uint32_t offset, uint32_t limit,
+                                char *json_buffer, size_t buf_size, uint32_t *total)
 {
     dpdk_cleanup_discovered_devices();
     
@@ -233,39 +517,51 @@ int dpdk_get_discovered_devices(uint16_t port_id, char *json_buffer, size_t buf_
     remaining -= written;
     
     int count = 0;
-    for (int i = 0; i < num_discovered; i++) {
-        if (discovered_devices[i].port_id == port_id) {
-            if (count > 0) {
-                written = snprintf(p, remaining, ",");
-                p += written;
-                remaining -= written;
-            }
-            
-            uint32_t ip = discovered_devices[i].ip_addr;
-            written = snprintf(p, remaining,
-                "{"
-                "\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\","
-                "\"ip\":\"%u.%u.%u.%u\","
-                "\"last_seen\":%ld,"
-                "\"packet_count\":%lu,"
-                "\"type\":\"%s\""
-                "}",
-                discovered_devices[i].mac_addr[0],
-                discovered_devices[i].mac_addr[1],
-                discovered_devices[i].mac_addr[2],
-                discovered_devices[i].mac_addr[3],
-                discovered_devices[i].mac_addr[4],
-                discovered_devices[i].mac_addr[5],
-                (ip >> 0) & 0xFF, (ip >> 8) & 0xFF,
-                (ip >> 16) & 0xFF, (ip >> 24) & 0xFF,
-                (long)discovered_devices[i].last_seen,
-                discovered_devices[i].packet_count,
-                discovered_devices[i].device_type
-            );
+    *total = 0;
+    for (uint32_t i = 0; i < discovery_max_positions; i++) {
+        const struct discovered_device *dev = &discovered_devices[i];
+        if (__atomic_load_n(&dev->in_use, __ATOMIC_ACQUIRE) != DEVICE_READY || dev->key.port_id != port_id) {
+            continue;
+        }
+        
+        // Keep counting past the page so the caller can report the rest
+        uint32_t index = (*total)++;
+        if (index < offset || (uint32_t)count >= limit || remaining <= 256) {
+            continue;
+        }
+        
+        if (count > 0) {
+            written = snprintf(p, remaining, ",");
             p += written;
             remaining -= written;
-            count++;
         }
+        
+        uint32_t ip = dev->key.ip_addr;
+        time_t last_seen = discovery_time_base +
+                           (time_t)((dev->last_seen - discovery_tsc_base) / rte_get_tsc_hz());
+        written = snprintf(p, remaining,
+            "{"
+            "\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\","
+            "\"ip\":\"%u.%u.%u.%u\","
+            "\"last_seen\":%ld,"
+            "\"packet_count\":%lu,"
+            "\"type\":\"%s\""
+            "}",
+            dev->key.mac_addr[0],
+            dev->key.mac_addr[1],
+            dev->key.mac_addr[2],
+            dev->key.mac_addr[3],
+            dev->key.mac_addr[4],
+            dev->key.mac_addr[5],
+            (ip >> 0) & 0xFF, (ip >> 8) & 0xFF,
+            (ip >> 16) & 0xFF, (ip >> 24) & 0xFF,
+            (long)last_seen,
+            dev->packet_count,
+            dev->device_type
+        );
+        p += written;
+        remaining -= written;
+        count++;
     }
     
     written = snprintf(p, remaining, "]");
@@ -273,6 +569,21 @@ int dpdk_get_discovered_devices(uint16_t port_id, char *json_buffer, size_t buf_
     return count;
 }
 
+/*
+ * Mbuf pool next to a port: the engine's per-socket "MBUF_POOL_S<n>",
+ * else a plain "MBUF_POOL"
+ */
+static struct rte_mempool *port_mempool(uint16_t port_id)
+{
+    char name[RTE_MEMPOOL_NAMESIZE];
+    int socket_id = rte_eth_dev_socket_id(port_id);
+    struct rte_mempool *pool;
+    
+    snprintf(name, sizeof(name), "MBUF_POOL_S%d", socket_id < 0 ? (int)rte_socket_id() : socket_id);
+    pool = rte_mempool_lookup(name);
+    return pool ? pool : rte_mempool_lookup("MBUF_POOL");
+}
+
 /*
  * Send ARP requests to probe for devices on the network
  * This actively discovers devices instead of waiting for traffic
@@ -292,9 +603,8 @@ int dpdk_send_arp_probe(uint16_t port_id, uint32_t target_ip)
     // Get our MAC address
     rte_eth_macaddr_get(port_id, &src_mac);
     
-    // Allocate mbuf (assuming pool named "MBUF_POOL" exists)
-    // In real code, you'd pass the pool as parameter
-    mbuf_pool = rte_mempool_lookup("MBUF_POOL");
+    // Allocate mbuf from the pool local to the port
+    mbuf_pool = port_mempool(port_id);
     if (!mbuf_pool) {
         return -1;
     }
@@ -338,31 +648,247 @@ int dpdk_send_arp_probe(uint16_t port_id, uint32_t target_ip)
     return 0;
 }
 
+/*
+ * Arm a non-blocking ARP sweep of base_ip/prefix_len (base_ip in network
+ * byte order). Probes leave through queue_id of port_id at rate_pps
+ * (0 = SCAN_DEFAULT_PPS) once the queue owner calls dpdk_scan_subnet_poll().
+ * Returns: 0 on success, -1 on error
+ */
+int dpdk_scan_subnet_start(uint16_t port_id, uint16_t queue_id, struct rte_mempool *pool,
+                           uint32_t base_ip, uint8_t prefix_len, uint32_t rate_pps)
+{
+    if (!rte_eth_dev_is_valid_port(port_id) || !pool ||
+        prefix_len < SCAN_MIN_PREFIX || prefix_len > 32) {
+        return -1;
+    }
+    int prev = __atomic_load_n(&scan.state, __ATOMIC_ACQUIRE);
+    if (prev != SCAN_IDLE && prev != SCAN_DONE && prev != SCAN_ABORTED) {
+        return -1;
+    }
+    
+    // Skip the network and broadcast addresses except on /31 and /32
+    uint32_t network = rte_be_to_cpu_32(base_ip) & (~0u << (32 - prefix_len));
+    uint32_t size = 1u << (32 - prefix_len);
+    uint32_t first_host = size > 2 ? network + 1 : network;
+    uint32_t num_hosts = size > 2 ? size - 2 : size;
+    
+    uint64_t *replied = rte_zmalloc("scan_replied", ((size_t)num_hosts + 63) / 64 * sizeof(uint64_t), 0);
+    if (!replied) {
+        return -1;
+    }
+    
+    // Quiescent handoff: once no reader holds the old sweep, it can go
+    if (!scan_transition(prev, SCAN_STARTING)) {
+        rte_free(replied);
+        return -1;
+    }
+    while (__atomic_load_n(&scan_refs, __ATOMIC_SEQ_CST)) {
+        rte_pause();
+    }
+    rte_free(scan.replied);
+    
+    // Probe template: broadcast ARP request from our MAC, sender IP 0
+    // (RFC 5227 probe, so hosts do not cache us); only the target IP changes
+    memset(&scan, 0, sizeof(scan));
+    scan.state = SCAN_STARTING;
+    struct rte_ether_hdr *eth_hdr = (struct rte_ether_hdr *)scan.probe;
+    struct rte_arp_hdr *arp_hdr = (struct rte_arp_hdr *)(eth_hdr + 1);
+    struct rte_ether_addr src_mac;
+    rte_eth_macaddr_get(port_id, &src_mac);
+    
+    memset(eth_hdr->dst_addr.addr_bytes, 0xFF, RTE_ETHER_ADDR_LEN);
+    rte_ether_addr_copy(&src_mac, &eth_hdr->src_addr);
+    eth_hdr->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_ARP);
+    arp_hdr->arp_hardware = rte_cpu_to_be_16(RTE_ARP_HRD_ETHER);
+    arp_hdr->arp_protocol = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+    arp_hdr->arp_hlen = RTE_ETHER_ADDR_LEN;
+    arp_hdr->arp_plen = 4;
+    arp_hdr->arp_opcode = rte_cpu_to_be_16(RTE_ARP_OP_REQUEST);
+    memcpy(arp_hdr->arp_data.arp_sha.addr_bytes, src_mac.addr_bytes, RTE_ETHER_ADDR_LEN);
+    
+    scan.port_id = port_id;
+    scan.queue_id = queue_id;
+    scan.pool = pool;
+    scan.first_host = first_host;
+    scan.num_hosts = num_hosts;
+    scan.rate_pps = rate_pps ? rate_pps : SCAN_DEFAULT_PPS;
+    scan.probe_cycles = RTE_MAX(rte_get_tsc_hz() / scan.rate_pps, (uint64_t)1);
+    scan.start_tsc = rte_rdtsc();
+    scan.next_tsc = scan.start_tsc;
+    scan.replied = replied;
+    
+    printf("Scanning %u hosts on port %u at %u probes/s\n", num_hosts, port_id, scan.rate_pps);
+    
+    __atomic_store_n(&scan.state, SCAN_SENDING, __ATOMIC_RELEASE);
+    return 0;
+}
+
 /*
  * Scan subnet for devices by sending ARP probes
  * e.g., scan 192.168.1.0/24
+ * Uses TX queue 0 and the port's local mempool at the default rate
  */
 int dpdk_scan_subnet(uint16_t port_id, uint32_t base_ip, uint8_t prefix_len)
 {
-    uint32_t num_hosts = (1 << (32 - prefix_len)) - 2;  // -2 for network and broadcast
+    return dpdk_scan_subnet_start(port_id, 0, port_mempool(port_id),
+                                  base_ip, prefix_len, 0);
+}
+
+/*
+ * Send the probes that are due (at most SCAN_BURST). Call from the lcore
+ * that owns the scan's TX queue, e.g. once per loop iteration.
+ * Returns: probes sent, 0 if none were due, -1 when no sweep is sending
+ */
+int dpdk_scan_subnet_poll(void)
+{
+    int state = scan_get();
+    uint64_t now = rte_rdtsc();
+    
+    if (state == SCAN_WAITING) {
+        if (now - scan.sent_tsc > rte_get_tsc_hz() / 1000 * SCAN_REPLY_WAIT_MS &&
+            scan_transition(SCAN_WAITING, SCAN_DONE)) {
+            scan.end_tsc = now;
+            printf("Scan complete: %u of %u hosts answered\n", scan.hosts_found, scan.num_hosts);
+        }
+        scan_put();
+        return -1;
+    }
+    if (state != SCAN_SENDING) {
+        scan_put();
+        return -1;
+    }
+    if (now < scan.next_tsc) {
+        scan_put();
+        return 0;
+    }
+    
+    uint64_t due = (now - scan.next_tsc) / scan.probe_cycles + 1;
+    uint32_t n = RTE_MIN(RTE_MIN(due, (uint64_t)SCAN_BURST), scan.num_hosts - scan.next_host);
+    
+    struct rte_mbuf *pkts[SCAN_BURST];
+    uint16_t nb_tx = 0;
+    if (rte_pktmbuf_alloc_bulk(scan.pool, pkts, n) == 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t *data = rte_pktmbuf_mtod(pkts[i], uint8_t *);
+            memcpy(data, scan.probe, sizeof(scan.probe));
+            struct rte_arp_hdr *arp_hdr = (struct rte_arp_hdr *)(data + sizeof(struct rte_ether_hdr));
+            arp_hdr->arp_data.arp_tip = rte_cpu_to_be_32(scan.first_host + scan.next_host + i);
+            pkts[i]->data_len = sizeof(scan.probe);
+            pkts[i]->pkt_len = sizeof(scan.probe);
+        }
+        
+        nb_tx = rte_eth_tx_burst(scan.port_id, scan.queue_id, pkts, n);
+        if (nb_tx < n) {
+            rte_pktmbuf_free_bulk(&pkts[nb_tx], n - nb_tx);
+        }
+    }
+    
+    // Probes that did not go out are skipped, not retried: the sweep keeps
+    // its rate and a missed host shows up in tx_failures
+    scan.tx_failures += n - nb_tx;
+    scan.probes_sent += nb_tx;
+    scan.next_host += n;
+    scan.next_tsc = RTE_MAX(scan.next_tsc + n * scan.probe_cycles, now - SCAN_BURST * scan.probe_cycles);
     
-    if (num_hosts > 1024) {
-        num_hosts = 1024;  // Limit scan size
+    if (scan.next_host == scan.num_hosts) {
+        scan.sent_tsc = now;
+        scan_transition(SCAN_SENDING, SCAN_WAITING);
+    }
+    scan_put();
+    return nb_tx;
+}
+
+/*
+ * Stop a running sweep (hosts found so far stay reported)
+ */
+void dpdk_scan_subnet_abort(void)
+{
+    if (scan_transition(SCAN_SENDING, SCAN_ABORTED) ||
+        scan_transition(SCAN_WAITING, SCAN_ABORTED)) {
+        scan.end_tsc = rte_rdtsc();
     }
+}
+
+/*
+ * Sweep progress as JSON, with the discovered hosts once it has finished:
+ * at most 'limit' of them from the offset-th on, as many as fit
+ * Returns: number of hosts found
+ */
+int dpdk_scan_subnet_status(uint32_t offset, uint32_t limit, char *json_buffer, size_t buf_size)
+{
+    static const char *state_names[] = {"idle", "sending", "waiting", "done", "aborted", "starting"};
+    int state = __atomic_load_n(&scan.state, __ATOMIC_ACQUIRE);
+    uint64_t end = (state == SCAN_DONE || state == SCAN_ABORTED) ? scan.end_tsc : rte_rdtsc();
+    uint64_t elapsed_ms = state == SCAN_IDLE ? 0 : (end - scan.start_tsc) * 1000 / rte_get_tsc_hz();
+    uint32_t found = __atomic_load_n(&scan.hosts_found, __ATOMIC_RELAXED);
+    
+    char *p = json_buffer;
+    size_t remaining = buf_size;
+    int written;
     
-    printf("Scanning %u hosts on port %u...\n", num_hosts, port_id);
+    written = snprintf(p, remaining,
+        "{"
+        "\"state\":\"%s\","
+        "\"port_id\":%u,"
+        "\"hosts\":%u,"
+        "\"probes_sent\":%lu,"
+        "\"tx_failures\":%lu,"
+        "\"hosts_found\":%u,"
+        "\"progress_pct\":%.1f,"
+        "\"rate_pps\":%u,"
+        "\"elapsed_ms\":%lu",
+        state_names[state], scan.port_id, scan.num_hosts,
+        scan.probes_sent, scan.tx_failures, found,
+        scan.num_hosts ? scan.next_host * 100.0 / scan.num_hosts : 0.0,
+        scan.rate_pps, elapsed_ms);
+    p += written;
+    remaining -= written;
     
-    for (uint32_t i = 1; i <= num_hosts; i++) {
-        uint32_t target_ip = base_ip + rte_cpu_to_be_32(i);
-        dpdk_send_arp_probe(port_id, target_ip);
+    if (state == SCAN_DONE || state == SCAN_ABORTED) {
+        // Discovered set: answered targets with the MAC the table learned
+        written = snprintf(p, remaining, ",\"discovered\":[");
+        p += written;
+        remaining -= written;
         
-        // Small delay to avoid overwhelming the network
-        if (i % 10 == 0) {
-            rte_delay_us(1000);  // 1ms delay every 10 probes
+        uint32_t count = 0, total = 0;
+        for (uint32_t i = 0; i < discovery_max_positions; i++) {
+            const struct discovered_device *dev = &discovered_devices[i];
+            if (__atomic_load_n(&dev->in_use, __ATOMIC_ACQUIRE) != DEVICE_READY || dev->key.port_id != scan.port_id) {
+                continue;
+            }
+            uint32_t index = rte_be_to_cpu_32(dev->key.ip_addr) - scan.first_host;
+            if (index >= scan.num_hosts || !(scan.replied[index >> 6] & (1ULL << (index & 63)))) {
+                continue;
+            }
+            
+            // Keep counting past the page so the reply says what is left
+            uint32_t pos = total++;
+            if (pos < offset || count >= limit || remaining <= 256) {
+                continue;
+            }
+            
+            uint32_t ip = dev->key.ip_addr;
+            written = snprintf(p, remaining,
+                "%s{\"ip\":\"%u.%u.%u.%u\",\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\"}",
+                count > 0 ? "," : "",
+                (ip >> 0) & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, (ip >> 24) & 0xFF,
+                dev->key.mac_addr[0], dev->key.mac_addr[1], dev->key.mac_addr[2],
+                dev->key.mac_addr[3], dev->key.mac_addr[4], dev->key.mac_addr[5]);
+            p += written;
+            remaining -= written;
+            count++;
         }
+        
+        written = snprintf(p, remaining,
+            "],\"discovered_offset\":%u,\"discovered_count\":%u,\"discovered_total\":%u,"
+            "\"truncated\":%s",
+            offset, count, total, offset + count < total ? "true" : "false");
+        p += written;
+        remaining -= written;
     }
     
-    return 0;
+    snprintf(p, remaining, "}");
+    return found;
 }
 
 /*
@@ -10,6 +10,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
  * Get link status for a DPDK port
  * Returns: 1 = link up, 0 = link down, -1 = error
@@ -27,23 +31,44 @@ int dpdk_get_port_info(uint16_t port_id, char *info_buffer, size_t buf_size);
  */
 const char* dpdk_get_link_speed_str(uint32_t speed);
 
+/*
+ * Create the discovered-device table (call once after rte_eal_init)
+ * max_devices: capacity, 0 for the default (65536)
+ * Returns: 0 on success, -1 on error
+ */
+int dpdk_discovery_init(uint32_t max_devices, int socket_id);
+
+/*
+ * Free the discovered-device table
+ */
+void dpdk_discovery_free(void);
+
 /*
  * Inspect received packet for device discovery
- * Call this for every RX packet in your main loop
+ * Call this for every RX packet in your main loop; lock-free, O(1) and safe
+ * from several RX lcores at once
  */
 void dpdk_inspect_packet_for_discovery(uint16_t port_id, struct rte_mbuf *pkt);
 
 /*
  * Clean up stale discovered devices
- * Call periodically (e.g., every 60 seconds)
+ * Call periodically (e.g., every 60 seconds) from a control thread
  */
 void dpdk_cleanup_discovered_devices(void);
 
 /*
- * Get all discovered devices on a port as JSON
- * Returns number of devices found
+ * Devices in the table and ARP senders dropped because it was full
+ */
+void dpdk_discovery_stats(uint32_t *devices, uint64_t *table_full);
+
+/*
+ * Discovered devices on a port as a JSON array: up to 'limit' of them from
+ * the offset-th on, as many as fit in the buffer. *total is the number of
+ * devices on the port, so the caller can tell a partial page.
+ * Returns number of devices written
  */
-int dpdk_get_discovered_devices(uint16_t port_id, char *json_buffer, size_t buf_size);
+int dpdk_get_discovered_devices(uint16_t port_id, uint32_t offset, uint32_t limit,
+                                char *json_buffer, size_t buf_size, uint32_t *total);
 
 /*
  * Send ARP probe to discover a specific device
@@ -52,16 +77,50 @@ int dpdk_get_discovered_devices(uint16_t port_id, char *json_buffer, size_t buf_
 int dpdk_send_arp_probe(uint16_t port_id, uint32_t target_ip);
 
 /*
- * Scan entire subnet for devices
+ * Start a non-blocking ARP sweep of a subnet (/8 or longer)
  * base_ip: Network address in network byte order (e.g., 192.168.1.0)
- * prefix_len: CIDR prefix (e.g., 24 for /24)
+ * prefix_len: CIDR prefix (e.g., 16 for /16)
+ * rate_pps: probes per second, 0 for the default (100000)
+ * Probes are sent by dpdk_scan_subnet_poll(); replies are matched by
+ * dpdk_inspect_packet_for_discovery()
+ * Returns: 0 on success, -1 on error or if a sweep is already running
+ */
+int dpdk_scan_subnet_start(uint16_t port_id, uint16_t queue_id, struct rte_mempool *pool,
+                           uint32_t base_ip, uint8_t prefix_len, uint32_t rate_pps);
+
+/*
+ * Start a sweep on TX queue 0 with the port's local mempool ("MBUF_POOL_S<socket>",
+ * else "MBUF_POOL") at the default rate
  */
 int dpdk_scan_subnet(uint16_t port_id, uint32_t base_ip, uint8_t prefix_len);
 
+/*
+ * Send the probes that are due, in bursts
+ * Call from the lcore that owns the sweep's TX queue
+ * Returns: probes sent, 0 if none were due, -1 when no sweep is sending
+ */
+int dpdk_scan_subnet_poll(void);
+
+/*
+ * Abort a running sweep
+ */
+void dpdk_scan_subnet_abort(void);
+
+/*
+ * Sweep progress as JSON; includes the discovered hosts once finished,
+ * paged like dpdk_get_discovered_devices() ("truncated" while more remain)
+ * Returns number of hosts that answered
+ */
+int dpdk_scan_subnet_status(uint32_t offset, uint32_t limit, char *json_buffer, size_t buf_size);
+
 /*
  * Get status of all ports as JSON
  * Buffer should be large enough for all ports (suggest 4096 bytes minimum)
  */
 int dpdk_get_all_port_status(char *json_buffer, size_t buf_size);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* DPDK_LINK_DISCOVERY_H */
@@ -0,0 +1,83 @@
+/*
+ * NetGen Pro - Multi-process attachment
+ *
+ * The engine runs as the DPDK primary process. Helper tools (ARP probes,
+ * packet capture) start with the same --file-prefix and
+ * --proc-type=secondary and find everything they need through the
+ * NETGEN_MP_INFO_NAME memzone:
+ *
+ *     mz = rte_memzone_lookup(NETGEN_MP_INFO_NAME);
+ *     info = mz->addr;                // check magic and version
+ *     pool = rte_mempool_lookup(info->ports[i].pool_name);
+ *     inject = rte_ring_lookup(info->ports[i].inject_ring);
+ *     capture = rte_ring_lookup(info->ports[i].capture_ring);
+ *
+ * Inject: frames allocated from the port's pool and enqueued on the inject
+ * ring (multi-producer) are sent by the engine's resolver thread on its own
+ * TX queue. The engine takes ownership of every enqueued mbuf.
+ *
+ * Capture: while capture_consumers is non-zero the engine enqueues the
+ * frames without a test signature that reach the port (ARP, LLDP, anything
+ * the DUT sends on its own) on the capture ring. Frames are dropped when the
+ * ring is full; the consumer frees what it dequeues. Concurrent consumers
+ * share the ring, so each frame reaches only one.
+ *
+ * A consumer attaches by claiming a free slot of consumer_pids with a
+ * compare-and-swap from 0 to its PID, then incrementing capture_consumers.
+ * It detaches by swapping its PID back to 0 and decrementing the count.
+ * The engine checks the slots about once a second. It releases the slot of
+ * a consumer that died without detaching, and it empties the ring once no
+ * consumer is left.
+ *
+ * A secondary must use an lcore no engine worker runs on (-l), since mempool
+ * caches are per lcore id. The engine's main lcore is fine.
+ *
+ * The statistics region (netgen_stats_shm.h) is plain POSIX shared memory
+ * and needs no EAL at all; its name is listed here for completeness.
+ */
+
+#ifndef NETGEN_MP_H
+#define NETGEN_MP_H
+
+#include <stdint.h>
+
+#define NETGEN_MP_INFO_NAME "netgen_mp_info"
+#define NETGEN_MP_MAGIC 0x504D474EU         // "NGMP" little-endian
+#define NETGEN_MP_VERSION 2
+
+#define NETGEN_MP_MAX_PORTS 2
+#define NETGEN_MP_NAME_LEN 32               // RTE_RING_NAMESIZE / RTE_MEMPOOL_NAMESIZE
+#define NETGEN_MP_RING_SIZE 1024
+#define NETGEN_MP_MAX_CONSUMERS 8
+
+enum netgen_mp_port_role {
+    NETGEN_MP_PORT_TX = 0,
+    NETGEN_MP_PORT_RX = 1
+};
+
+struct __attribute__((aligned(64))) netgen_mp_port {
+    uint16_t port_id;
+    uint8_t role;                           // netgen_mp_port_role
+    uint8_t reserved;
+    uint32_t capture_consumers;             // Attached consumers (atomic add/sub)
+    char pool_name[NETGEN_MP_NAME_LEN];
+    char inject_ring[NETGEN_MP_NAME_LEN];
+    char capture_ring[NETGEN_MP_NAME_LEN];
+    int32_t consumer_pids[NETGEN_MP_MAX_CONSUMERS];  // 0 = free slot
+    uint64_t injected;                      // Frames sent from the inject ring
+    uint64_t inject_dropped;                // TX queue full
+    uint64_t captured;
+    uint64_t capture_dropped;               // Capture ring full
+};
+
+struct __attribute__((aligned(64))) netgen_mp_info {
+    uint32_t magic;
+    uint32_t version;
+    int32_t primary_pid;
+    uint32_t num_ports;
+    char stats_shm_name[NETGEN_MP_NAME_LEN];
+    char control_socket[108];               // sizeof(sockaddr_un.sun_path)
+    struct netgen_mp_port ports[NETGEN_MP_MAX_PORTS];
+};
+
+#endif // NETGEN_MP_H
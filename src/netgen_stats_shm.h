@@ -0,0 +1,180 @@
+/*
+ * NetGen Pro - Shared-memory statistics region
+ *
+ * The engine publishes its counters into a POSIX shared-memory object so
+ * collectors can sample them without going through the control socket.
+ *
+ * Readers map NETGEN_STATS_SHM_NAME read-only and take snapshots with the
+ * seqlock in the header:
+ *
+ *     do {
+ *         s1 = hdr->seq;              // retry while odd (update in progress)
+ *         read barrier; copy; read barrier;
+ *     } while ((s1 & 1) || hdr->seq != s1);
+ *
+ * Sections are located through the offset/stride/count fields of the
+ * header, so new fields can be appended to a record without breaking
+ * readers. Incompatible layout changes bump NETGEN_STATS_VERSION.
+ *
+ * The binary time-series batch format at the end of this file shares the
+ * version number.
+ */
+
+#ifndef NETGEN_STATS_SHM_H
+#define NETGEN_STATS_SHM_H
+
+#include <stdint.h>
+
+#define NETGEN_STATS_SHM_NAME "/netgen_stats"
+#define NETGEN_STATS_MAGIC 0x5453474EU      // "NGST" little-endian
+#define NETGEN_STATS_VERSION 1
+
+#define NETGEN_STATS_MAX_PROFILES 64
+#define NETGEN_STATS_MAX_PORTS 2
+#define NETGEN_STATS_MAX_LCORES 128
+
+// Upper bounds (ns) of netgen_stats_profile.latency_buckets[0..15];
+// the last bucket counts everything above 100 ms
+#define NETGEN_STATS_LAT_BOUNDS_NS { \
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, \
+    1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000 }
+#define NETGEN_STATS_LAT_BUCKETS 17
+
+enum netgen_stats_lcore_role {
+    NETGEN_STATS_LCORE_IDLE = 0,
+    NETGEN_STATS_LCORE_TX = 1,
+    NETGEN_STATS_LCORE_RX = 2
+};
+
+struct __attribute__((aligned(64))) netgen_stats_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  // Whole region in bytes
+    uint32_t running;               // Traffic running
+    volatile uint64_t seq;          // Seqlock: odd while the engine writes
+    uint64_t update_count;
+    uint64_t update_tsc;            // TSC of the last update
+    uint64_t update_unix_ns;        // CLOCK_REALTIME of the last update
+    uint64_t tsc_hz;
+    uint32_t publish_hz;
+
+    uint32_t profiles_offset;
+    uint32_t profile_stride;
+    uint32_t num_profiles;
+    uint32_t ports_offset;
+    uint32_t port_stride;
+    uint32_t num_ports;
+    uint32_t lcores_offset;
+    uint32_t lcore_stride;
+    uint32_t num_lcores;
+};
+
+// Per traffic profile: TX counters and the RX analysis of its stream
+struct __attribute__((aligned(64))) netgen_stats_profile {
+    char name[32];
+    uint16_t stream_id;
+    uint16_t reserved[3];
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_dropped;       // Local TX drops
+    uint64_t packets_received;      // Unique + duplicates
+    uint64_t bytes_received;
+    uint64_t lost_packets;
+    uint64_t out_of_order;
+    uint64_t duplicates;
+    uint64_t late_arrivals;
+    uint64_t latency_count;
+    uint64_t latency_min_ns;
+    uint64_t latency_avg_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_p999_ns;
+    uint64_t jitter_ns;             // RFC 3550
+    uint64_t latency_sum_ns;
+    uint64_t latency_buckets[NETGEN_STATS_LAT_BUCKETS];  // Per bucket, not cumulative
+};
+
+// Per port: NIC counters (rte_eth_stats)
+struct __attribute__((aligned(64))) netgen_stats_port {
+    uint16_t port_id;
+    uint16_t reserved[3];
+    uint64_t ipackets;
+    uint64_t opackets;
+    uint64_t ibytes;
+    uint64_t obytes;
+    uint64_t imissed;
+    uint64_t ierrors;
+    uint64_t oerrors;
+    uint64_t rx_nombuf;
+};
+
+#define NETGEN_STATS_TX_STAGES 4     // alloc, build, tx_burst, free
+
+// Per worker lcore. Cycle counters stay zero when the engine is built
+// without ENABLE_CYCLE_STATS; tx_queue_full and alloc_failures are always
+// counted.
+struct __attribute__((aligned(64))) netgen_stats_lcore {
+    uint16_t lcore_id;
+    uint8_t role;                   // netgen_stats_lcore_role
+    uint8_t reserved;
+    uint16_t queue_id;
+    uint16_t reserved2;
+    uint64_t packets;               // Sent (TX) or received (RX)
+    uint64_t bytes;
+    uint64_t unsigned_packets;      // RX frames without a test signature
+    uint64_t busy_cycles;           // Polls that moved frames
+    uint64_t idle_cycles;           // Empty polls
+    uint64_t busy_polls;
+    uint64_t idle_polls;
+    uint64_t stage_cycles[NETGEN_STATS_TX_STAGES];
+    uint64_t tx_queue_full;         // tx_burst calls that left frames behind
+    uint64_t alloc_failures;        // Mempool allocation failures
+};
+
+struct netgen_stats_region {
+    struct netgen_stats_header header;
+    struct netgen_stats_profile profiles[NETGEN_STATS_MAX_PROFILES];
+    struct netgen_stats_port ports[NETGEN_STATS_MAX_PORTS];
+    struct netgen_stats_lcore lcores[NETGEN_STATS_MAX_LCORES];
+};
+
+/*
+ * Binary time-series batch ("timeseries" control command with
+ * "format":"binary", length-framed connections only): one header followed
+ * by num_samples records of sample_size bytes. Each record is a
+ * netgen_timeseries_sample followed by num_profiles
+ * netgen_timeseries_counters. All counters are cumulative; rates are the
+ * deltas between consecutive samples. Counters restart from 0 when the
+ * statistics are reset (every test trial): treat a decrease as a reset,
+ * not as a wrap. unix_ns is CLOCK_REALTIME and may step; the engine takes
+ * its own rates from a monotonic clock. Records are interval_us apart: the
+ * sampler's interval, or a multiple of it when the request asked for a
+ * coarser "interval_us".
+ */
+#define NETGEN_TIMESERIES_MAGIC 0x5354474EU   // "NGTS" little-endian
+
+struct __attribute__((packed)) netgen_timeseries_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t interval_us;
+    uint32_t num_profiles;
+    uint32_t num_samples;
+    uint32_t sample_size;
+    uint64_t first_seq;             // Sequence number of the first record (the rate base)
+    uint64_t next_seq;              // Pass as "since" to continue
+};
+
+struct __attribute__((packed)) netgen_timeseries_counters {
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+};
+
+struct __attribute__((packed)) netgen_timeseries_sample {
+    uint64_t unix_ns;
+    struct netgen_timeseries_counters port;     // TX port / RX port totals
+};
+
+#endif // NETGEN_STATS_SHM_H
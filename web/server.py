@@ -10,7 +10,7 @@ Features:
 - Enhanced timeout handling (3s stats, 10s stop, 15s start)
 - Profile management with SQLite
 - Test history tracking
-- WebSocket real-time stats
+- WebSocket real-time stats (read from the engine's shared-memory region)
 """
 
 from flask import Flask, render_template, request, jsonify
@@ -25,6 +25,7 @@ import threading
 import socket as sock
 import sqlite3
 from datetime import datetime
+from stats_shm import StatsShmReader
 
 app = Flask(__name__)
 app.config['SECRET_KEY'] = 'netgen-unified-key'
@@ -97,26 +98,107 @@ def init_database():
 
 init_database()
 
+# One persistent, length-framed control connection shared by all requests
+_control_conn = None
+_control_lock = threading.Lock()
+
+def _recv_exact(client, n):
+    data = b''
+    while len(data) < n:
+        chunk = client.recv(n - len(data))
+        if not chunk: raise ConnectionError('Engine closed the control connection')
+        data += chunk
+    return data
+
 def send_dpdk_command(command_dict, timeout=10):
-    try:
-        client = sock.socket(sock.AF_UNIX, sock.SOCK_STREAM)
-        client.settimeout(timeout)
-        client.connect(CONTROL_SOCKET)
-        client.sendall(json.dumps(command_dict).encode() + b'\n')
-        response = b''
-        while True:
-            chunk = client.recv(4096)
-            if not chunk: break
-            response += chunk
-            if b'\n' in chunk: break
-        client.close()
-        return json.loads(response.decode().strip()) if response else {'status': 'error'}
-    except sock.timeout:
-        return {'status': 'error', 'message': 'Timeout'}
-    except FileNotFoundError:
-        return {'status': 'error', 'message': 'Engine not running'}
-    except Exception as e:
-        return {'status': 'error', 'message': str(e)}
+    global _control_conn
+    payload = json.dumps(command_dict).encode()
+    with _control_lock:
+        for attempt in range(2):
+            try:
+                if _control_conn is None:
+                    _control_conn = sock.socket(sock.AF_UNIX, sock.SOCK_STREAM)
+                    _control_conn.settimeout(timeout)
+                    _control_conn.connect(CONTROL_SOCKET)
+                _control_conn.settimeout(timeout)
+                _control_conn.sendall(len(payload).to_bytes(4, 'big') + payload)
+                length = int.from_bytes(_recv_exact(_control_conn, 4), 'big')
+                response = _recv_exact(_control_conn, length)
+                return json.loads(response.decode().strip()) if response else {'status': 'error'}
+            except sock.timeout:
+                _control_conn.close()
+                _control_conn = None
+                return {'status': 'error', 'message': 'Timeout'}
+            except FileNotFoundError:
+                _control_conn = None
+                return {'status': 'error', 'message': 'Engine not running'}
+            except (ConnectionError, BrokenPipeError, OSError) as e:
+                # Engine restarted: reconnect once
+                if _control_conn: _control_conn.close()
+                _control_conn = None
+                if attempt == 1: return {'status': 'error', 'message': str(e)}
+            except Exception as e:
+                return {'status': 'error', 'message': str(e)}
+
+# Statistics come from the engine's shared-memory region (--stats-hz); the
+# control socket is only used when the engine does not publish it
+stats_reader = StatsShmReader()
+SHM_STALE_NS = 2_000_000_000
+_rate_lock = threading.Lock()
+_rate_state = {'t_ns': 0, 'tx_bytes': 0, 'rx_bytes': 0, 'tx_mbps': 0.0, 'rx_mbps': 0.0}
+
+def _shm_rates(t_ns, tx_bytes, rx_bytes):
+    """TX/RX Mbps between successive snapshots at least 0.5 s apart."""
+    with _rate_lock:
+        st = _rate_state
+        dt = (t_ns - st['t_ns']) / 1e9
+        if not st['t_ns'] or tx_bytes < st['tx_bytes'] or rx_bytes < st['rx_bytes']:
+            # First snapshot, or the counters were reset: restart the window
+            st.update(t_ns=t_ns, tx_bytes=tx_bytes, rx_bytes=rx_bytes, tx_mbps=0.0, rx_mbps=0.0)
+        elif dt >= 0.5:
+            st['tx_mbps'] = (tx_bytes - st['tx_bytes']) * 8 / dt / 1e6
+            st['rx_mbps'] = (rx_bytes - st['rx_bytes']) * 8 / dt / 1e6
+            st.update(t_ns=t_ns, tx_bytes=tx_bytes, rx_bytes=rx_bytes)
+        return st['tx_mbps'], st['rx_mbps']
+
+def read_stats_shm():
+    """Engine statistics from shared memory in the "stats" command's layout, or None."""
+    stale = lambda snap: snap is None or time.time_ns() - snap['update_unix_ns'] > SHM_STALE_NS
+    snap = stats_reader.snapshot()
+    if stale(snap):
+        stats_reader.close()  # Engine gone or restarted: map the new region
+        snap = stats_reader.snapshot()
+    # A crashed engine leaves its region behind: fall back to the socket
+    if stale(snap) or snap['update_count'] == 0:
+        return None
+
+    profiles = snap['profiles']
+    total = lambda key: sum(p[key] for p in profiles)
+    measured = [p for p in profiles if p['latency_count'] > 0]
+    latency_count = sum(p['latency_count'] for p in measured)
+    tx_mbps, rx_mbps = _shm_rates(snap['update_unix_ns'], total('bytes_sent'), total('bytes_received'))
+
+    return {'running': snap['running'], 'profiles': profiles, 'ports': snap['ports'],
+            'lcores': snap['lcores'],
+            'packets_sent': total('packets_sent'), 'bytes_sent': total('bytes_sent'),
+            'packets_received': total('packets_received'), 'bytes_received': total('bytes_received'),
+            'out_of_order': total('out_of_order'), 'duplicates': total('duplicates'),
+            'late_arrivals': total('late_arrivals'), 'lost_packets': total('lost_packets'),
+            'latency_min_ns': min((p['latency_min_ns'] for p in measured), default=0),
+            'latency_avg_ns': sum(p['latency_avg_ns'] * p['latency_count'] for p in measured) // latency_count
+                              if latency_count else 0,
+            'latency_max_ns': max((p['latency_max_ns'] for p in measured), default=0),
+            'tx_rate_mbps': tx_mbps, 'rx_rate_mbps': rx_mbps, 'throughput_mbps': tx_mbps}
+
+def get_stats():
+    """(ok, data or error message), shared memory first."""
+    data = read_stats_shm()
+    if data is not None:
+        return True, data
+    response = send_dpdk_command({'command': 'stats'}, timeout=3)
+    if response.get('status') == 'success':
+        return True, response.get('data', {})
+    return False, response.get('message')
 
 def get_link_status(interface):
     try:
@@ -182,8 +264,8 @@ def api_stop():
 
 @app.route('/api/stats')
 def api_stats():
-    response = send_dpdk_command({'command': 'stats'}, timeout=3)
-    return jsonify(response.get('data', {})) if response.get('status') == 'success' else jsonify({'error': response.get('message')}), 500
+    ok, data = get_stats()
+    return jsonify(data) if ok else (jsonify({'error': data}), 500)
 
 @app.route('/api/ports/status')
 def get_ports_status():
@@ -208,8 +290,8 @@ def stats_broadcast():
     while True:
         if current_status.get('running'):
             try:
-                r = send_dpdk_command({'command': 'stats'}, timeout=2)
-                if r.get('status') == 'success': socketio.emit('stats_update', r.get('data', {}), broadcast=True)
+                ok, data = get_stats()
+                if ok: socketio.emit('stats_update', data, broadcast=True)
             except: pass
         time.sleep(1)
 
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+NetGen Pro - Shared-memory statistics reader
+
+Reads the region the DPDK engine publishes at /dev/shm/netgen_stats
+(layout: src/netgen_stats_shm.h) without going through the control socket.
+
+    reader = StatsShmReader()
+    snap = reader.snapshot()    # dict, or None if the engine is not publishing
+"""
+
+import mmap
+import os
+import struct
+import time
+
+SHM_PATH = '/dev/shm/netgen_stats'
+MAGIC = 0x5453474E
+VERSION = 1
+
+HEADER = struct.Struct('<IIIIQQQQQIIIIIIIIII')
+PROFILE = struct.Struct('<32sH6x17Q')
+PORT = struct.Struct('<H6x8Q')
+LCORE = struct.Struct('<HBxH2x13Q')
+
+PROFILE_FIELDS = ('packets_sent', 'bytes_sent', 'packets_dropped', 'packets_received',
+                  'bytes_received', 'lost_packets', 'out_of_order', 'duplicates',
+                  'late_arrivals', 'latency_count', 'latency_min_ns', 'latency_avg_ns',
+                  'latency_max_ns', 'latency_p50_ns', 'latency_p99_ns', 'latency_p999_ns',
+                  'jitter_ns')
+PORT_FIELDS = ('ipackets', 'opackets', 'ibytes', 'obytes', 'imissed', 'ierrors',
+               'oerrors', 'rx_nombuf')
+LCORE_ROLES = ('idle', 'tx', 'rx')
+TX_STAGES = ('alloc', 'build', 'tx_burst', 'free')
+
+
+class StatsShmReader:
+    def __init__(self, path=SHM_PATH):
+        self.path = path
+        self.mm = None
+
+    def _open(self):
+        if self.mm is not None:
+            return True
+        try:
+            fd = os.open(self.path, os.O_RDONLY)
+        except FileNotFoundError:
+            return False
+        try:
+            self.mm = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ)
+        finally:
+            os.close(fd)
+        return True
+
+    def close(self):
+        if self.mm is not None:
+            self.mm.close()
+            self.mm = None
+
+    def _seq(self):
+        return struct.unpack_from('<Q', self.mm, 16)[0]
+
+    def snapshot(self, retries=100):
+        """Consistent copy of the region (seqlock), or None."""
+        if not self._open():
+            return None
+        for _ in range(retries):
+            seq = self._seq()
+            if seq & 1:
+                time.sleep(0)
+                continue
+            data = self.mm[:]
+            if self._seq() == seq:
+                return self._parse(data)
+        return None
+
+    def _parse(self, data):
+        (magic, version, size, running, seq, update_count, update_tsc, update_unix_ns,
+         tsc_hz, publish_hz, profiles_off, profile_stride, num_profiles,
+         ports_off, port_stride, num_ports, lcores_off, lcore_stride,
+         num_lcores) = HEADER.unpack_from(data, 0)
+        if magic != MAGIC or version != VERSION:
+            return None
+
+        profiles = []
+        for i in range(num_profiles):
+            rec = PROFILE.unpack_from(data, profiles_off + i * profile_stride)
+            entry = {'name': rec[0].split(b'\0', 1)[0].decode(errors='replace'),
+                     'stream_id': rec[1]}
+            entry.update(zip(PROFILE_FIELDS, rec[2:]))
+            profiles.append(entry)
+
+        ports = []
+        for i in range(num_ports):
+            rec = PORT.unpack_from(data, ports_off + i * port_stride)
+            entry = {'port_id': rec[0]}
+            entry.update(zip(PORT_FIELDS, rec[1:]))
+            ports.append(entry)
+
+        lcores = []
+        for i in range(num_lcores):
+            rec = LCORE.unpack_from(data, lcores_off + i * lcore_stride)
+            lcore_id, role, queue_id, packets, nbytes, unsigned = rec[:6]
+            busy, idle, busy_polls, idle_polls = rec[6:10]
+            lcores.append({'lcore_id': lcore_id,
+                           'role': LCORE_ROLES[role] if role < len(LCORE_ROLES) else 'unknown',
+                           'queue_id': queue_id, 'packets': packets, 'bytes': nbytes,
+                           'unsigned_packets': unsigned,
+                           'busy_cycles': busy, 'idle_cycles': idle,
+                           'busy_polls': busy_polls, 'idle_polls': idle_polls,
+                           'stage_cycles': dict(zip(TX_STAGES, rec[10:14])),
+                           'tx_queue_full': rec[14], 'alloc_failures': rec[15]})
+
+        return {'running': bool(running), 'update_count': update_count,
+                'update_unix_ns': update_unix_ns, 'publish_hz': publish_hz,
+                'profiles': profiles, 'ports': ports, 'lcores': lcores}
+
+
+if __name__ == '__main__':
+    import json
+    print(json.dumps(StatsShmReader().snapshot(), indent=2))